@@ -0,0 +1,112 @@
+// Compares funnelling every TU result into one map with per-worker partial
+// maps combined by reduce_files, on a synthetic tree where every TU includes
+// a slice of a large set of shared headers.
+//
+// usage: bench_merge [tus] [headers] [includes per tu] [lines per header]
+//                    [max threads, default the CPUs]
+#include "files_merge.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace {
+
+struct workload_t
+{
+    unsigned tus = 10000;
+    unsigned headers = 1000;
+    unsigned includes = 20;
+    unsigned lines = 50;
+};
+
+counted_files_t make_tu(const workload_t& w, unsigned tu)
+{
+    std::mt19937 rng{tu};
+    counted_files_t files;
+    auto& source = files["/src/tu" + std::to_string(tu) + ".cpp"];
+    for (unsigned l = 1; l <= 200; ++l)
+        source.emplace_back(l, rng() % 4);
+    for (unsigned i = 0; i < w.includes; ++i)
+    {
+        auto& header = files["/src/include/h" +
+                             std::to_string(rng() % w.headers) + ".hpp"];
+        header.clear();
+        for (unsigned l = 1; l <= w.lines; ++l)
+            header.emplace_back(l, rng() % 2);
+    }
+    return files;
+}
+
+std::vector<counted_files_t> make_tus(const workload_t& w)
+{
+    std::vector<counted_files_t> tus;
+    tus.reserve(w.tus);
+    for (unsigned tu = 0; tu < w.tus; ++tu)
+        tus.push_back(make_tu(w, tu));
+    return tus;
+}
+
+template<typename F>
+double seconds(F f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    workload_t w;
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned* params[] = {&w.tus, &w.headers, &w.includes, &w.lines,
+                          &max_threads};
+    for (int i = 1; i < argc && i <= 5; ++i)
+        *params[i - 1] = std::stoul(argv[i]);
+    std::cout << w.tus << " TUs, " << w.headers << " headers, " <<
+        w.includes << " includes per TU, " << w.lines << " lines per header\n";
+
+    std::size_t expected_files = 0;
+    {
+        auto tus = make_tus(w);
+        counted_files_t rv;
+        const auto t = seconds([&] {
+            for (auto& tu : tus)
+                merge_files(rv, std::move(tu));
+        });
+        expected_files = rv.size();
+        std::cout << "serial merge_files:   " << t << " s\n";
+    }
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        auto tus = make_tus(w);
+        std::vector<counted_files_t> partials(threads);
+        counted_files_t rv;
+        const auto t_partial = seconds([&] {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t)
+                workers.emplace_back([&, t] {
+                    for (auto i = t; i < tus.size(); i += threads)
+                        merge_files(partials[t], std::move(tus[i]));
+                });
+            for (auto& worker : workers)
+                worker.join();
+        });
+        const auto t_reduce = seconds([&] {
+            rv = reduce_files(std::move(partials), threads);
+        });
+        if (rv.size() != expected_files)
+        {
+            std::cerr << "file count mismatch\n";
+            return 1;
+        }
+        std::cout << threads << " threads: partials " << t_partial <<
+            " s + reduce_files " << t_reduce << " s = " <<
+            t_partial + t_reduce << " s\n";
+    }
+}
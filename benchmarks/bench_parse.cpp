@@ -0,0 +1,142 @@
+// Compares the type erased parse_llvm_json overload (std::function selector
+// called with a std::string built per record) with the template specialized
+// on path_selector_t, on a synthetic llvm-cov export where every file entry
+// lists the functions of all headers it includes.
+//
+// usage: bench_parse [files] [functions per file] [regions per function]
+#include "gcov_json_parser.hpp"
+#include "selectors.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct workload_t
+{
+    unsigned files = 200;
+    unsigned functions = 500;
+    unsigned regions = 4;
+};
+
+std::string path(unsigned i)
+{
+    return "/home/user/project/src/include/detail/module_" +
+        std::to_string(i) + ".hpp";
+}
+
+// filenames receives the filename of every record in document order
+std::string make_export(const workload_t& w,
+                        std::vector<std::string>& filenames)
+{
+    std::string json = R"({"data": [{"files": [)";
+    for (unsigned f = 0; f < w.files; ++f)
+    {
+        json += (f ? "," : "");
+        filenames.push_back(path(f));
+        json += R"({"filename": ")" + path(f) +
+            R"(", "segments": [[1, 1, 1, true, true, false]], "functions": [)";
+        for (unsigned fn = 0; fn < w.functions; ++fn)
+        {
+            json += (fn ? "," : "");
+            filenames.push_back(path((f + fn) % w.files));
+            json += R"({"filename": ")" + path((f + fn) % w.files) +
+                R"(", "regions": [)";
+            for (unsigned r = 0; r < w.regions; ++r)
+                json += (r ? "," : "") + std::string{"["} +
+                    std::to_string(fn + r + 1) + ", 1, 2, 2, " +
+                    std::to_string(r) + ", 0, 0, 0]";
+            json += "]}";
+        }
+        json += "]}";
+    }
+    return json + "]}]}";
+}
+
+// best of a few runs, the first one also pays for page faults
+template<typename F>
+double seconds(F f)
+{
+    double best = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double> t =
+            std::chrono::steady_clock::now() - start;
+        best = i ? std::min(best, t.count()) : t.count();
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    workload_t w;
+    unsigned* params[] = {&w.files, &w.functions, &w.regions};
+    for (int i = 1; i < argc && i <= 3; ++i)
+        *params[i - 1] = std::stoul(argv[i]);
+    std::vector<std::string> filenames;
+    const auto json = make_export(w, filenames);
+    const auto records = static_cast<double>(w.files) * (w.functions + 1);
+    std::cout << w.files << " files, " << w.functions <<
+        " functions per file, " << w.regions << " regions per function, " <<
+        json.size() / 1e6 << " MB\n";
+
+    const auto selected = path(w.files / 2);
+    const auto document = seconds([&] {
+        parse_json_document(json);
+    });
+
+    counted_files_t erased;
+    const filename_selector_t selector = [&selected] (const auto& x) {
+        return x == selected;
+    };
+    const auto t_erased = seconds([&] {
+        erased.clear();
+        parse_llvm_json(erased, json, selector);
+    });
+
+    counted_files_t specialized;
+    const path_selector_t path_selector{selected};
+    const auto t_specialized = seconds([&] {
+        specialized.clear();
+        parse_llvm_json(specialized, json, path_selector);
+    });
+    if (erased != specialized)
+    {
+        std::cerr << "result mismatch\n";
+        return 1;
+    }
+
+    // the selection alone, on the filename of every record
+    std::size_t erased_hits = 0;
+    const auto t_erased_select = seconds([&] {
+        erased_hits = 0;
+        for (const auto& filename : filenames)
+            erased_hits += selector(filename.c_str());
+    });
+    std::size_t specialized_hits = 0;
+    const auto t_specialized_select = seconds([&] {
+        specialized_hits = 0;
+        for (const auto& filename : filenames)
+            specialized_hits += path_selector(
+                std::string_view{filename.c_str(), filename.size()});
+    });
+    if (erased_hits != specialized_hits)
+    {
+        std::cerr << "selection mismatch\n";
+        return 1;
+    }
+
+    const auto per_record = [&] (double t) {
+        return t / records * 1e9;
+    };
+    std::cout << "json document only:         " << document << " s\n" <<
+        "std::function selector:     " << t_erased << " s, selection " <<
+        per_record(t_erased_select) << " ns/record\n" <<
+        "path_selector_t (template): " << t_specialized << " s, selection " <<
+        per_record(t_specialized_select) << " ns/record\n";
+}
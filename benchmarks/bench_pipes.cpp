@@ -0,0 +1,141 @@
+// Drains j children writing a multi-MB report each, as process_files does,
+// once through the asio io_context and once through uring_reactor_t.
+// Prints throughput, the reads from /proc/self/io (with asio each one is a
+// read(2) call, plus the epoll_waits, io_uring issues them inside
+// io_uring_enter), the io_uring_enter calls and the voluntary context
+// switches.
+//
+// usage: bench_pipes [j] [MB per child] [rounds]
+#include "process_files.hpp"
+#include "spawn_launcher.hpp"
+#include "uring_reactor.hpp"
+#include <sys/resource.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+struct counters_t
+{
+    std::uint64_t read_calls = 0;
+    long context_switches = 0;
+};
+
+counters_t counters()
+{
+    counters_t rv;
+    std::ifstream io{"/proc/self/io"};
+    for (std::string key; io >> key;)
+    {
+        std::uint64_t value;
+        io >> value;
+        if (key == "syscr:")
+            rv.read_calls = value;
+    }
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    rv.context_switches = usage.ru_nvcsw;
+    return rv;
+}
+
+struct child_t
+{
+    explicit child_t(boost::asio::io_context& ctx) : out{ctx}, err{ctx} {}
+    boost::process::async_pipe out;
+    std::string out_buf;
+    boost::process::async_pipe err;
+    std::string err_buf;
+    std::unique_ptr<boost::process::child> child;
+};
+
+// seconds for one round, children included
+double drain_round(const spawn_launcher_t& launcher, unsigned j,
+                   std::size_t bytes, uring_reactor_t* uring)
+{
+    const auto start = std::chrono::steady_clock::now();
+    boost::asio::io_context ctx;
+    std::deque<child_t> children;
+    for (unsigned i = 0; i < j; ++i)
+    {
+        auto& c = children.emplace_back(ctx);
+        c.child = launcher("/dev/zero", c.err, c.out, ctx);
+    }
+    if (uring)
+    {
+        std::vector<uring_reactor_t::pipe_t> pipes;
+        for (auto& c : children)
+        {
+            pipes.push_back({c.out.native_source(), &c.out_buf});
+            pipes.push_back({c.err.native_source(), &c.err_buf});
+        }
+        uring->read_all(pipes);
+    }
+    else
+    {
+        for (auto& c : children)
+        {
+            async_read_all(c.out, c.out_buf);
+            async_read_all(c.err, c.err_buf);
+        }
+        ctx.run();
+    }
+    for (auto& c : children)
+    {
+        c.child->wait();
+        if (c.out_buf.size() != bytes)
+            throw std::runtime_error{"short read"};
+    }
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    unsigned j = 64;
+    unsigned mb = 4;
+    unsigned rounds = 3;
+    unsigned* params[] = {&j, &mb, &rounds};
+    for (int i = 1; i < argc && i <= 3; ++i)
+        *params[i - 1] = std::stoul(argv[i]);
+    const std::size_t bytes = std::size_t{mb} << 20;
+    const spawn_launcher_t launcher{"head", {"-c", std::to_string(bytes)}};
+    std::cout << j << " children, " << mb << " MB each, best of " <<
+        rounds << " rounds\n";
+
+    std::optional<uring_reactor_t> uring;
+    try
+    {
+        uring.emplace();
+    }
+    catch (const std::system_error& ex)
+    {
+        std::cout << "io_uring unavailable: " << ex.what() << "\n";
+    }
+
+    std::vector<uring_reactor_t*> reactors{nullptr};
+    if (uring)
+        reactors.push_back(&*uring);
+    for (auto* reactor : reactors)
+    {
+        const auto before = counters();
+        const auto enters = reactor ? reactor->stats().enters : 0;
+        double best = 0;
+        for (unsigned r = 0; r < rounds; ++r)
+        {
+            const auto t = drain_round(launcher, j, bytes, reactor);
+            best = r ? std::min(best, t) : t;
+        }
+        const auto after = counters();
+        std::cout << (reactor ? "io_uring: " : "asio:     ") << best <<
+            " s, " << j * mb / best << " MB/s, " <<
+            (after.read_calls - before.read_calls) / rounds <<
+            " reads, " <<
+            ((reactor ? reactor->stats().enters : 0) - enters) / rounds <<
+            " io_uring_enter calls, " <<
+            (after.context_switches - before.context_switches) / rounds <<
+            " context switches per round\n";
+    }
+}
@@ -1,5 +1,5 @@
+from collections import OrderedDict
 from pathlib import Path
-import multiprocessing
 import _vimgcov
 import tempfile
 import subprocess
@@ -10,6 +10,29 @@ DEPS_DIR = Path("./target/debug/deps")
 # TODO make it configurable
 LLVM_PROFDATA = "llvm-profdata"
 LLVM_COV = "llvm-cov"
+# Number of gcov/llvm-cov processes run at once, 0 adapts it to the cgroup
+# CPU quota, affinity, memory and how CPU bound the children are.
+JOBS = 0
+# lcov tracefile or Cobertura xml (e.g. build/coverage.info) to read instead
+# of running gcov on every gcno file
+TRACEFILE = os.environ.get("VIMGCOV_TRACEFILE")
+# Answer with the coverage of the TU built from the file as soon as gcov ran
+# on it, the sweep over the other TUs goes on in the background and the
+# requests for the file after it finished get the merged result, until the
+# gcda files change and a new sweep starts.
+EARLY_ANSWER = bool(os.environ.get("VIMGCOV_EARLY_ANSWER"))
+# filename -> (gcda stamp, CoverageSweep), least recently used first. One
+# sweep runs at a time, starting one cancels the others.
+_sweeps = OrderedDict()
+MAX_SWEEPS = 16
+# cancelled sweeps still running their last jobs, dropping them would wait
+_cancelled = []
+# Unix socket of a running vimgcovd, which keeps the coverage of the build
+# directory in memory for every editor, gcov runs in process when no daemon
+# listens on it. Empty picks the default, VIMGCOV_SOCKET or
+# $XDG_RUNTIME_DIR/vimgcov.sock; VIMGCOV_NO_DAEMON=1 skips the query.
+DAEMON_SOCKET = ""
+USE_DAEMON = not os.environ.get("VIMGCOV_NO_DAEMON")
 
 
 def debug(*args, **kwargs):
@@ -17,37 +40,107 @@ def debug(*args, **kwargs):
         print(*args, file=f, **kwargs)
 
 
-def get_llvm_rust_coverage_lines(filename):
-    if not DEPS_DIR.is_dir():
-        raise FileNotFoundError("No deps directory found")
+def get_llvm_cov_coverage(executables, profiles, filename):
     with tempfile.TemporaryDirectory() as directory:
         profdata = os.path.join(directory, "a.profdata")
         proc = subprocess.Popen([
             LLVM_PROFDATA, "merge",
             "-o", profdata,
-            *map(str, Path(".").rglob("*.profraw")),
+            *profiles,
         ], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         stdout, stderr = proc.communicate()
         if proc.returncode != 0:
             print(stdout.decode())
             print(stderr.decode())
             return
+        return _vimgcov.getllvmcoverage(executables, JOBS, filename, profdata)
+
+
+def get_llvm_rust_coverage_lines(filename):
+    if not DEPS_DIR.is_dir():
+        raise FileNotFoundError("No deps directory found")
 
-        def filter_file(file):
-            return file.is_file() and os.access(str(file), os.X_OK)
-        executables = list(map(str, filter(filter_file, DEPS_DIR.iterdir())))
-        files = _vimgcov.getllvmcoverage(executables,
-                                         multiprocessing.cpu_count(),
-                                         filename, profdata)
+    def filter_file(file):
+        return file.is_file() and os.access(str(file), os.X_OK)
+    executables = list(map(str, filter(filter_file, DEPS_DIR.iterdir())))
+    profiles = list(map(str, Path(".").rglob("*.profraw")))
+    try:
+        # reads the profiles and the coverage mapping of the executables
+        # directly, without merging and exporting with llvm tools
+        files = _vimgcov.getnativellvmcoverage(executables, profiles,
+                                               filename)
+    except RuntimeError as ex:
+        # e.g. a format version newer than the native reader knows
+        debug("native llvm coverage failed:", ex)
+        files = get_llvm_cov_coverage(executables, profiles, filename)
+        if files is None:
+            return
     return process_return_value(filename, files)
 
 
+def get_tracefile_coverage_lines(filename):
+    files = _vimgcov.gettracefilecoverage(TRACEFILE, filename)
+    return process_return_value(filename, files)
+
+
+def gcda_stamp(gcnos):
+    stamp = []
+    for gcno in sorted(gcnos):
+        try:
+            mtime = Path(gcno).with_suffix(".gcda").stat().st_mtime_ns
+        except OSError:
+            mtime = None
+        stamp.append((gcno, mtime))
+    return tuple(stamp)
+
+
+def get_early_coverage_lines(filename, gcnos):
+    global _cancelled
+    _cancelled = [sweep for sweep in _cancelled if not sweep.done()]
+    stamp = gcda_stamp(gcnos)
+    cached = _sweeps.pop(filename, None)
+    if cached is None or cached[0] != stamp or cached[1].cancelled():
+        for _, sweep in _sweeps.values():
+            if not sweep.done():
+                sweep.cancel()
+                _cancelled.append(sweep)
+        if cached is not None and not cached[1].done():
+            cached[1].cancel()
+            _cancelled.append(cached[1])
+        cached = (stamp, _vimgcov.CoverageSweep(gcnos, JOBS, filename))
+    _sweeps[filename] = cached
+    while len(_sweeps) > MAX_SWEEPS:
+        _sweeps.popitem(last=False)
+    sweep = cached[1]
+    if sweep.done():
+        return process_return_value(filename, sweep.result())
+    return process_return_value(filename, sweep.first())
+
+
+def query_daemon(filename):
+    try:
+        return _vimgcov.querydaemon(DAEMON_SOCKET, os.getcwd(), filename)
+    except RuntimeError as ex:
+        debug("vimgcovd query failed:", ex)
+
+
 def get_gcc_coverage_gcov_lines(filename):
+    if TRACEFILE:
+        return get_tracefile_coverage_lines(filename)
+
+    if USE_DAEMON:
+        files = query_daemon(filename)
+        if files is not None:
+            return process_return_value(filename, files)
+
     # Search for all .gcno files in the current directory and subdirectories
     gcnos = list(map(str, Path('.').rglob("*.gcno")))
 
+    if EARLY_ANSWER:
+        return get_early_coverage_lines(filename, gcnos)
+
     # Get coverage information using _vimgcov module
-    files = _vimgcov.getcoverage(gcnos, multiprocessing.cpu_count(), filename)
+    files = _vimgcov.getcoverage(gcnos, JOBS, filename)
 
     return process_return_value(filename, files)
 
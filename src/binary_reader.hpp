@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "gcov_json_handler.hpp"
+
+// Bounds checked little-endian reader over a memory mapped file or section.
+// Reading past the end throws parse_exception.
+class binary_reader_t
+{
+public:
+    binary_reader_t(const void* data, std::size_t size)
+        : begin_{static_cast<const char*>(data)}, pos_{begin_},
+          end_{begin_ + size} {}
+    explicit binary_reader_t(std::string_view data)
+        : binary_reader_t(data.data(), data.size()) {}
+
+    template<typename T>
+    T read()
+    {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::uint64_t read_uleb128()
+    {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0;; shift += 7)
+        {
+            const auto byte = static_cast<unsigned char>(*take(1));
+            if (shift < 64)
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+    }
+
+    std::string_view read_bytes(std::size_t size)
+    {
+        return {take(size), size};
+    }
+
+    void skip(std::size_t size) { take(size); }
+
+    // skips to the next multiple of alignment counted from the start, the
+    // padding of the last record may be missing
+    void align(std::size_t alignment)
+    {
+        const auto offset = pos_ - begin_;
+        pos_ += std::min((alignment - offset % alignment) % alignment,
+                         remaining());
+    }
+
+    std::size_t offset() const { return pos_ - begin_; }
+    std::size_t remaining() const { return end_ - pos_; }
+    bool empty() const { return pos_ == end_; }
+
+private:
+    const char* take(std::size_t size)
+    {
+        if (size > remaining())
+            throw parse_exception{"Unexpected end of binary data"};
+        const auto* rv = pos_;
+        pos_ += size;
+        return rv;
+    }
+
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+};
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "binary_reader_t reads little-endian data natively");
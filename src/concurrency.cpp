@@ -0,0 +1,190 @@
+#include "concurrency.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+
+namespace {
+
+constexpr auto unlimited = std::numeric_limits<std::uint64_t>::max();
+
+// path of this process' cgroup v2 directory, empty on cgroup v1
+std::string cgroup2_dir()
+{
+    std::ifstream in{"/proc/self/cgroup"};
+    std::string line;
+    while (std::getline(in, line))
+        if (line.rfind("0::", 0) == 0)
+            return "/sys/fs/cgroup" + line.substr(3);
+    return {};
+}
+
+// Reads one number from a cgroup file. "max" and missing files are treated
+// as unlimited.
+std::uint64_t read_limit(const std::string& path)
+{
+    std::ifstream in{path};
+    std::string value;
+    if (!(in >> value) || value == "max" || value == "-1")
+        return unlimited;
+    try
+    {
+        return std::stoull(value);
+    }
+    catch (const std::exception&)
+    {
+        return unlimited;
+    }
+}
+
+// Calls f on the cgroup v2 directory and on each of its parents, the
+// tightest limit along the path is the effective one.
+template<typename F>
+void for_each_cgroup2_dir(F f)
+{
+    auto dir = cgroup2_dir();
+    if (dir.empty())
+        return;
+    while (dir.size() >= std::string{"/sys/fs/cgroup"}.size())
+    {
+        f(dir);
+        const auto slash = dir.find_last_of('/');
+        if (slash == std::string::npos)
+            break;
+        dir.erase(slash);
+    }
+}
+
+unsigned cgroup_cpus()
+{
+    double quota = std::numeric_limits<double>::infinity();
+    for_each_cgroup2_dir([&] (const std::string& dir) {
+        std::ifstream in{dir + "/cpu.max"};
+        std::string max;
+        std::uint64_t period = 0;
+        if (in >> max >> period && max != "max" && period)
+            quota = std::min(quota, std::stod(max) / period);
+    });
+    for (const auto* dir : {"/sys/fs/cgroup/cpu,cpuacct",
+                            "/sys/fs/cgroup/cpu"})
+    {
+        const auto max = read_limit(std::string{dir} + "/cpu.cfs_quota_us");
+        const auto period = read_limit(std::string{dir} +
+                                       "/cpu.cfs_period_us");
+        if (max != unlimited && period != unlimited && period)
+            quota = std::min(quota, static_cast<double>(max) / period);
+    }
+    if (std::isinf(quota))
+        return std::numeric_limits<unsigned>::max();
+    return std::max(1u, static_cast<unsigned>(std::ceil(quota)));
+}
+
+std::uint64_t meminfo_available()
+{
+    std::ifstream in{"/proc/meminfo"};
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields{line};
+        std::string key;
+        std::uint64_t kb;
+        if (fields >> key >> kb && key == "MemAvailable:")
+            return kb * 1024;
+    }
+    return unlimited;
+}
+
+adaptive_limit_t::duration_t to_duration(const timeval& tv)
+{
+    return std::chrono::seconds{tv.tv_sec} +
+        std::chrono::microseconds{tv.tv_usec};
+}
+
+}
+
+unsigned available_cpus()
+{
+    unsigned cpus = 0;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        cpus = CPU_COUNT(&set);
+    if (!cpus)
+        cpus = std::max(1u, std::thread::hardware_concurrency());
+    return std::min(cpus, cgroup_cpus());
+}
+
+std::uint64_t available_memory()
+{
+    auto memory = meminfo_available();
+    for_each_cgroup2_dir([&] (const std::string& dir) {
+        const auto max = read_limit(dir + "/memory.max");
+        const auto current = read_limit(dir + "/memory.current");
+        if (max != unlimited && current != unlimited)
+            memory = std::min(memory, max > current ? max - current : 0);
+    });
+    const auto max = read_limit("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    const auto current = read_limit(
+        "/sys/fs/cgroup/memory/memory.usage_in_bytes");
+    if (max != unlimited && current != unlimited)
+        memory = std::min(memory, max > current ? max - current : 0);
+    return memory;
+}
+
+adaptive_limit_t::adaptive_limit_t()
+    : adaptive_limit_t(available_cpus())
+{
+}
+
+adaptive_limit_t::adaptive_limit_t(unsigned cpus)
+    : cpus_{std::max(1u, cpus)}, limit_{cpus_}
+{
+}
+
+void adaptive_limit_t::start_batch()
+{
+    batch_start_ = std::chrono::steady_clock::now();
+    batch_cpu_ = {};
+    batch_max_rss_ = 0;
+}
+
+void adaptive_limit_t::reaped(const rusage& usage)
+{
+    batch_cpu_ += to_duration(usage.ru_utime) + to_duration(usage.ru_stime);
+    batch_max_rss_ = std::max(batch_max_rss_,
+                              static_cast<std::uint64_t>(usage.ru_maxrss) *
+                              1024);
+}
+
+void adaptive_limit_t::end_batch(unsigned in_flight)
+{
+    const auto wall = std::chrono::steady_clock::now() - batch_start_;
+    update(wall, batch_cpu_, in_flight, batch_max_rss_, available_memory());
+}
+
+void adaptive_limit_t::update(duration_t wall, duration_t cpu,
+                              unsigned in_flight, std::uint64_t max_rss,
+                              std::uint64_t memory)
+{
+    if (wall.count() > 0 && in_flight)
+    {
+        // more children than CPUs can't use more than the CPUs, saturating
+        // them counts as fully CPU bound so an oversubscribed limit comes
+        // back down
+        const auto utilization = std::clamp(
+            static_cast<double>(cpu.count()) / wall.count() /
+            std::min(in_flight, cpus_), 0.0, 1.0);
+        utilization_ = (utilization_ + utilization) / 2;
+    }
+    const double max_limit = cpus_ * oversubscription;
+    auto limit = std::min(
+        max_limit,
+        std::round(cpus_ / std::max(utilization_, 1.0 / oversubscription)));
+    if (max_rss)
+        limit = std::min(limit, static_cast<double>(memory / max_rss));
+    limit_ = std::max(1u, static_cast<unsigned>(limit));
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+struct rusage;
+
+// CPUs usable by this process: the sched affinity mask capped by the cgroup
+// (v1 or v2) CPU quota. Always at least 1.
+unsigned available_cpus();
+
+// Bytes of memory children may still use: MemAvailable capped by the room
+// left under the cgroup memory limit.
+std::uint64_t available_memory();
+
+// Decides how many gcov/llvm-cov children run at once. Starts at the number
+// of available CPUs, then after every batch compares the CPU time the
+// children used to the wall time they were running. I/O bound children
+// (e.g. reading gcda files over NFS) let more of them run, and the limit is
+// capped so that children of the largest RSS of the batch fit into memory.
+// Only the children passed to reaped() count, RUSAGE_CHILDREN would also
+// take in every other descendant the process waited for, e.g. a compiler
+// run by Vim's :make, and its peak RSS never goes down.
+class adaptive_limit_t
+{
+public:
+    using duration_t = std::chrono::nanoseconds;
+    static constexpr unsigned oversubscription = 4;
+
+    adaptive_limit_t();
+    explicit adaptive_limit_t(unsigned cpus);
+
+    unsigned limit() const { return limit_; }
+
+    // starts the wall clock of a batch
+    void start_batch();
+    // accounts a child of the batch, with the usage wait4 reported for it
+    void reaped(const rusage& usage);
+    // updates the limit from the children reaped since start_batch
+    void end_batch(unsigned in_flight);
+
+    void update(duration_t wall, duration_t cpu, unsigned in_flight,
+                std::uint64_t max_rss, std::uint64_t memory);
+
+private:
+    unsigned cpus_;
+    unsigned limit_;
+    double utilization_ = 1.0;
+    std::chrono::steady_clock::time_point batch_start_;
+    duration_t batch_cpu_{};
+    std::uint64_t batch_max_rss_ = 0;
+};
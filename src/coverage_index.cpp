@@ -0,0 +1,76 @@
+#include "coverage_index.hpp"
+#include "gcov_json_parser.hpp"
+#include "selectors.hpp"
+#include <boost/filesystem.hpp>
+#include <sys/stat.h>
+
+namespace {
+
+std::int64_t mtime_ns(const std::string& path)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+        return 0;
+    return std::int64_t{st.st_mtim.tv_sec} * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+}
+
+coverage_index_t::coverage_index_t(start_process_t start_process, unsigned j)
+    : start_process_{std::move(start_process)}, j_{j}
+{
+}
+
+coverage_index_t::directory_t& coverage_index_t::directory(
+    const std::string& build_dir)
+{
+    std::lock_guard lock{mutex_};
+    auto& rv = directories_[build_dir];
+    if (!rv)
+        rv = std::make_unique<directory_t>();
+    return *rv;
+}
+
+std::optional<lines_t> coverage_index_t::lines(const std::string& build_dir,
+                                               const std::string& path)
+{
+    const auto root = boost::filesystem::canonical(build_dir).string();
+    auto& dir = directory(root);
+    std::lock_guard lock{dir.mutex};
+
+    stamps_t stamps;
+    for (const auto& entry :
+         boost::filesystem::recursive_directory_iterator(root))
+    {
+        if (entry.path().extension() != ".gcno" ||
+            !boost::filesystem::is_regular_file(entry.status()))
+            continue;
+        auto gcda = entry.path();
+        gcda.replace_extension(".gcda");
+        stamps.try_emplace(entry.path().string(),
+                           mtime_ns(entry.path().string()),
+                           mtime_ns(gcda.string()));
+    }
+
+    if (stamps != dir.stamps)
+    {
+        std::deque<std::string> gcnos;
+        for (const auto& [gcno, _] : stamps)
+            gcnos.push_back(gcno);
+        std::lock_guard sweep_lock{sweep_mutex_};
+        dir.files = process_files<files_t>(
+            start_process_,
+            [] (auto& files, const auto& buf) {
+                parse_gcov_json(files, buf, any_path_t{});
+            },
+            std::move(gcnos),
+            j_
+        );
+        dir.stamps = std::move(stamps);
+    }
+
+    const auto it = dir.files.find(path);
+    if (it == dir.files.end())
+        return std::nullopt;
+    return it->second;
+}
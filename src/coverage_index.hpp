@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include "gcov_json_handler.hpp"
+#include "vimgcov.hpp"
+
+// Coverage of every source of a build directory, from start_process (gcov
+// by default) run on all its gcnos, kept resident between queries. A query
+// stats the gcnos and gcdas of the directory and sweeps again only when one
+// of them was added, removed or rewritten since the last sweep. Queries for
+// the same directory wait for a running sweep instead of starting their
+// own, and sweeps of different directories run one at a time, so several
+// editors don't fight over the cores.
+class coverage_index_t
+{
+public:
+    explicit coverage_index_t(start_process_t start_process = gcov_launcher(),
+                              unsigned j = 0);
+
+    // lines of path, nullopt when no TU of build_dir reports it
+    std::optional<lines_t> lines(const std::string& build_dir,
+                                 const std::string& path);
+
+private:
+    // gcno path to the modification times of the gcno and gcda in ns, 0
+    // for a missing gcda
+    using stamps_t = std::map<std::string,
+                              std::pair<std::int64_t, std::int64_t>>;
+    struct directory_t
+    {
+        std::mutex mutex;
+        stamps_t stamps;
+        files_t files;
+    };
+
+    directory_t& directory(const std::string& build_dir);
+
+    start_process_t start_process_;
+    unsigned j_;
+    std::mutex mutex_;
+    std::mutex sweep_mutex_;
+    std::map<std::string, std::unique_ptr<directory_t>> directories_;
+};
@@ -0,0 +1,142 @@
+#include "coverage_io.hpp"
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace {
+
+constexpr std::array<char, 4> magic{'V', 'G', 'C', 'V'};
+constexpr std::uint32_t version = 1;
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "binary coverage format is little-endian");
+
+template<typename T>
+void put(std::ostream& out, T value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+T get(std::istream& in)
+{
+    T value;
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(value)))
+        throw parse_exception{"Truncated binary coverage file"};
+    return value;
+}
+
+// The sizes come from the file, a corrupt one must end in a
+// parse_exception at the end of the data instead of allocating gigabytes
+// up front.
+std::string get_string(std::istream& in)
+{
+    std::string value;
+    for (auto size = get<std::uint32_t>(in); size;)
+    {
+        const auto chunk = std::min<std::uint32_t>(size, 1 << 16);
+        const auto offset = value.size();
+        value.resize(offset + chunk);
+        if (!in.read(value.data() + offset, chunk))
+            throw parse_exception{"Truncated binary coverage file"};
+        size -= chunk;
+    }
+    return value;
+}
+
+}
+
+void write_json(std::ostream& out, const counted_files_t& files)
+{
+    rapidjson::StringBuffer buf;
+    rapidjson::Writer<rapidjson::StringBuffer> writer{buf};
+    writer.StartObject();
+    writer.Key("files");
+    writer.StartArray();
+    for (const auto& [path, lines] : files)
+    {
+        writer.StartObject();
+        writer.Key("file");
+        writer.String(path.c_str(), path.size());
+        writer.Key("lines");
+        writer.StartArray();
+        for (const auto& [lineno, count] : lines)
+        {
+            writer.StartObject();
+            writer.Key("line_number");
+            writer.Uint(lineno);
+            writer.Key("count");
+            writer.Uint64(count);
+            writer.Key("unexecuted_block");
+            writer.Bool(!count);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    out.write(buf.GetString(), buf.GetSize());
+    out << '\n';
+}
+
+void write_lcov(std::ostream& out, const counted_files_t& files)
+{
+    out << "TN:\n";
+    for (const auto& [path, lines] : files)
+    {
+        if (lines.empty())
+            continue;
+        out << "SF:" << path << '\n';
+        for (const auto& [lineno, count] : lines)
+            out << "DA:" << lineno << ',' << count << '\n';
+        out << "LF:" << lines.size() << '\n';
+        out << "LH:" << std::count_if(lines.begin(), lines.end(),
+                                       [] (const auto& line) {
+                                           return std::get<1>(line) != 0;
+                                       }) << '\n';
+        out << "end_of_record\n";
+    }
+}
+
+void write_binary(std::ostream& out, const counted_files_t& files)
+{
+    out.write(magic.data(), magic.size());
+    put<std::uint32_t>(out, version);
+    put<std::uint32_t>(out, files.size());
+    for (const auto& [path, lines] : files)
+    {
+        put<std::uint32_t>(out, path.size());
+        out.write(path.data(), path.size());
+        put<std::uint32_t>(out, lines.size());
+        for (const auto& [lineno, count] : lines)
+        {
+            put<std::uint32_t>(out, lineno);
+            put<std::uint64_t>(out, count);
+        }
+    }
+}
+
+counted_files_t read_binary(std::istream& in)
+{
+    std::array<char, 4> header;
+    if (!in.read(header.data(), header.size()) || header != magic)
+        throw parse_exception{"Not a binary coverage file"};
+    if (get<std::uint32_t>(in) != version)
+        throw parse_exception{"Unsupported binary coverage version"};
+    counted_files_t files;
+    for (auto n = get<std::uint32_t>(in); n; --n)
+    {
+        auto& lines = files[get_string(in)];
+        for (auto m = get<std::uint32_t>(in); m; --m)
+        {
+            const auto lineno = get<std::uint32_t>(in);
+            lines.emplace_back(lineno, get<std::uint64_t>(in));
+        }
+    }
+    return files;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <iosfwd>
+#include "gcov_json_handler.hpp"
+
+// Same layout as gcov's json, so parse_gcov_json can read it back.
+void write_json(std::ostream& out, const counted_files_t& files);
+// lcov tracefile, one SF/DA/LF/LH/end_of_record block per file.
+void write_lcov(std::ostream& out, const counted_files_t& files);
+// Compact little-endian binary: "VGCV", u32 version, u32 file count, then per
+// file u32 path length, path, u32 line count and (u32 lineno, u64 count)
+// pairs.
+void write_binary(std::ostream& out, const counted_files_t& files);
+counted_files_t read_binary(std::istream& in);
@@ -0,0 +1,106 @@
+#include "coverage_sweep.hpp"
+#include "gcov_json_parser.hpp"
+#include "job_ranking.hpp"
+#include "selectors.hpp"
+#include "vimgcov.hpp"
+#include <stdexcept>
+
+template<typename files_T>
+coverage_sweep_t<files_T>::coverage_sweep_t(std::deque<std::string> gcnos,
+                                            unsigned j,
+                                            std::string path,
+                                            std::string gcov)
+{
+    const bool matched = rank_by_similarity(gcnos, path) > 0;
+    thread_ = std::thread{[this, gcnos=std::move(gcnos), j, matched,
+                           path=std::move(path),
+                           gcov=std::move(gcov)] () mutable {
+        const path_selector_t selector{path};
+        const auto sweep = [&] (auto early_answer) {
+            return process_files<files_T>(
+                [this, launcher=gcov_launcher_t{gcov}] (auto&&... args) {
+                    if (cancelled_)
+                        throw std::runtime_error{"coverage sweep cancelled"};
+                    return launcher(args...);
+                },
+                [&selector] (auto& files, const auto& buf) {
+                    parse_gcov_json(files, buf, selector);
+                },
+                std::move(gcnos),
+                j,
+                early_answer);
+        };
+        try
+        {
+            auto result = matched ?
+                sweep([this, &path] (const files_T& answer) {
+                    const auto it = answer.find(path);
+                    if (it == answer.end() || it->second.empty())
+                        return;
+                    std::lock_guard lock{mutex_};
+                    first_ = answer;
+                    cv_.notify_all();
+                }) :
+                sweep(no_early_answer_t{});
+            std::lock_guard lock{mutex_};
+            result_ = std::move(result);
+        }
+        catch (...)
+        {
+            std::lock_guard lock{mutex_};
+            error_ = std::current_exception();
+        }
+        cv_.notify_all();
+    }};
+}
+
+template<typename files_T>
+coverage_sweep_t<files_T>::~coverage_sweep_t()
+{
+    cancel();
+    thread_.join();
+}
+
+template<typename files_T>
+files_T coverage_sweep_t<files_T>::first()
+{
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this] { return first_ || result_ || error_; });
+    if (result_)
+        return *result_;
+    if (first_)
+        return *first_;
+    std::rethrow_exception(error_);
+}
+
+template<typename files_T>
+files_T coverage_sweep_t<files_T>::result()
+{
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this] { return result_ || error_; });
+    if (error_)
+        std::rethrow_exception(error_);
+    return *result_;
+}
+
+template<typename files_T>
+bool coverage_sweep_t<files_T>::done() const
+{
+    std::lock_guard lock{mutex_};
+    return result_ || error_;
+}
+
+template<typename files_T>
+void coverage_sweep_t<files_T>::cancel()
+{
+    cancelled_ = true;
+}
+
+template<typename files_T>
+bool coverage_sweep_t<files_T>::cancelled() const
+{
+    return cancelled_;
+}
+
+template class coverage_sweep_t<files_t>;
+template class coverage_sweep_t<counted_files_t>;
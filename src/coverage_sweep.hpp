@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "gcov_json_handler.hpp"
+
+// gcov run on every gcno for the coverage of path, on a background thread.
+// The gcnos are ranked by similarity to path, so first() usually returns
+// after a single gcov run: the lines of path reported by the TU built from
+// it. The sweep goes on for lines other TUs contribute (e.g. inline
+// functions of a header), result() waits for all of them. When no gcno is
+// named after path (a header, or a source without its own TU) or that TU
+// doesn't cover it, first() waits for the whole sweep, one arbitrary TU's
+// view would show lines only the others executed as unexecuted. An empty
+// gcov picks gcov_tool(). cancel() stops launching gcov, the running jobs
+// are dropped and first()/result() throw unless they were answered already.
+template<typename files_T = files_t>
+class coverage_sweep_t
+{
+public:
+    coverage_sweep_t(std::deque<std::string> gcnos, unsigned j,
+                     std::string path, std::string gcov = {});
+    // cancels and waits for the sweep, children aren't left behind
+    ~coverage_sweep_t();
+
+    coverage_sweep_t(const coverage_sweep_t&) = delete;
+    coverage_sweep_t& operator=(const coverage_sweep_t&) = delete;
+
+    files_T first();
+    files_T result();
+    bool done() const;
+    void cancel();
+    bool cancelled() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::optional<files_T> first_;
+    std::optional<files_T> result_;
+    std::exception_ptr error_;
+    std::atomic<bool> cancelled_{false};
+    std::thread thread_;
+};
+
+extern template class coverage_sweep_t<files_t>;
+extern template class coverage_sweep_t<counted_files_t>;
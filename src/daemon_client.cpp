@@ -0,0 +1,39 @@
+#include "daemon_client.hpp"
+#include "daemon_protocol.hpp"
+#include <cstdlib>
+#include <unistd.h>
+
+std::string default_socket_path()
+{
+    if (const auto* path = std::getenv("VIMGCOV_SOCKET"); path && *path)
+        return path;
+    if (const auto* dir = std::getenv("XDG_RUNTIME_DIR"); dir && *dir)
+        return std::string{dir} + "/vimgcov.sock";
+    return "/tmp/vimgcov-" + std::to_string(::getuid()) + ".sock";
+}
+
+std::optional<files_t> query_daemon(const std::string& socket_path,
+                                    const std::string& build_dir,
+                                    const std::string& path)
+{
+    boost::asio::io_context ctx;
+    boost::asio::local::stream_protocol::socket socket{ctx};
+    boost::system::error_code ec;
+    socket.connect(socket_path.empty() ? default_socket_path() : socket_path,
+                   ec);
+    // missing socket file or a stale one left behind by a killed daemon
+    if (ec)
+        return std::nullopt;
+
+    write_frame(socket, encode_request({build_dir, path}));
+    auto response = decode_response(read_frame(socket));
+    switch (response.status)
+    {
+    case coverage_response_t::ok:
+        return files_t{{path, std::move(response.lines)}};
+    case coverage_response_t::not_found:
+        return files_t{};
+    default:
+        throw std::runtime_error{"vimgcovd: " + response.message};
+    }
+}
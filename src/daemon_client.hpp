@@ -0,0 +1,17 @@
+#pragma once
+#include <optional>
+#include <string>
+#include "gcov_json_handler.hpp"
+
+// $VIMGCOV_SOCKET, else vimgcov.sock in $XDG_RUNTIME_DIR, else
+// /tmp/vimgcov-<uid>.sock
+std::string default_socket_path();
+
+// Coverage of path in build_dir from the vimgcovd listening on socket_path
+// (default_socket_path() when empty), in the same shape as getcoverage:
+// {path: lines} or {} when no TU reports path. nullopt when no daemon
+// listens, the caller then runs gcov in process. Errors the daemon reports
+// throw std::runtime_error.
+std::optional<files_t> query_daemon(const std::string& socket_path,
+                                    const std::string& build_dir,
+                                    const std::string& path);
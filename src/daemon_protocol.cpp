@@ -0,0 +1,172 @@
+#include "daemon_protocol.hpp"
+#include "binary_reader.hpp"
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <limits>
+#include <poll.h>
+
+namespace {
+
+constexpr std::string_view request_magic{"VGCQ"};
+constexpr std::string_view response_magic{"VGCR"};
+
+template<typename T>
+void put(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_string(std::string& out, std::string_view value)
+{
+    put(out, static_cast<std::uint32_t>(value.size()));
+    out.append(value);
+}
+
+std::string get_string(binary_reader_t& reader)
+{
+    return std::string{reader.read_bytes(reader.read<std::uint32_t>())};
+}
+
+void check_header(binary_reader_t& reader, std::string_view magic)
+{
+    if (reader.read_bytes(magic.size()) != magic)
+        throw parse_exception{"Not a vimgcovd message"};
+    const auto version = reader.read<std::uint32_t>();
+    if (version != daemon_protocol_version)
+        throw parse_exception{"Unsupported vimgcovd protocol version " +
+                              std::to_string(version)};
+}
+
+}
+
+std::string encode_request(const coverage_request_t& request)
+{
+    std::string out{request_magic};
+    put(out, daemon_protocol_version);
+    put_string(out, request.build_dir);
+    put_string(out, request.path);
+    return out;
+}
+
+coverage_request_t decode_request(std::string_view payload)
+{
+    binary_reader_t reader{payload};
+    check_header(reader, request_magic);
+    coverage_request_t request;
+    request.build_dir = get_string(reader);
+    request.path = get_string(reader);
+    return request;
+}
+
+std::string encode_response(const coverage_response_t& response)
+{
+    std::string out{response_magic};
+    put(out, daemon_protocol_version);
+    put(out, static_cast<std::uint32_t>(response.status));
+    if (response.status == coverage_response_t::ok)
+    {
+        out.reserve(out.size() + 4 + response.lines.size() * 5);
+        put(out, static_cast<std::uint32_t>(response.lines.size()));
+        for (const auto& [lineno, unexecuted] : response.lines)
+        {
+            put(out, static_cast<std::uint32_t>(lineno));
+            put(out, static_cast<std::uint8_t>(unexecuted));
+        }
+    }
+    else if (response.status == coverage_response_t::error)
+        put_string(out, response.message);
+    return out;
+}
+
+coverage_response_t decode_response(std::string_view payload)
+{
+    binary_reader_t reader{payload};
+    check_header(reader, response_magic);
+    coverage_response_t response;
+    const auto status = reader.read<std::uint32_t>();
+    switch (status)
+    {
+    case coverage_response_t::ok:
+    {
+        response.status = coverage_response_t::ok;
+        const auto count = reader.read<std::uint32_t>();
+        if (count > reader.remaining() / 5)
+            throw parse_exception{"vimgcovd response lines out of bounds"};
+        response.lines.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            const auto lineno = reader.read<std::uint32_t>();
+            response.lines.emplace_back(lineno,
+                                        reader.read<std::uint8_t>() != 0);
+        }
+        break;
+    }
+    case coverage_response_t::not_found:
+        response.status = coverage_response_t::not_found;
+        break;
+    case coverage_response_t::error:
+        response.status = coverage_response_t::error;
+        response.message = get_string(reader);
+        break;
+    default:
+        throw parse_exception{"Unknown vimgcovd response status " +
+                              std::to_string(status)};
+    }
+    return response;
+}
+
+void write_frame(boost::asio::local::stream_protocol::socket& socket,
+                 const std::string& payload)
+{
+    if (payload.size() > max_frame_size)
+        throw parse_exception{"vimgcovd frame too large"};
+    const auto size = static_cast<std::uint32_t>(payload.size());
+    const std::array buffers{
+        boost::asio::buffer(&size, sizeof(size)),
+        boost::asio::buffer(payload),
+    };
+    boost::asio::write(socket, buffers);
+}
+
+std::string read_frame(boost::asio::local::stream_protocol::socket& socket,
+                       std::chrono::milliseconds timeout)
+{
+    using clock_t = std::chrono::steady_clock;
+    const auto deadline = clock_t::now() + timeout;
+    // SO_RCVTIMEO doesn't help, asio's blocking read polls again on EAGAIN
+    const auto read = [&] (boost::asio::mutable_buffer buffer) {
+        if (timeout.count() == 0)
+        {
+            boost::asio::read(socket, buffer);
+            return;
+        }
+        while (buffer.size())
+        {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(
+                deadline - clock_t::now()).count();
+            pollfd readable{socket.native_handle(), POLLIN, 0};
+            const auto ready = left > 0 ?
+                ::poll(&readable, 1, static_cast<int>(std::min<std::int64_t>(
+                    left, std::numeric_limits<int>::max()))) : 0;
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready < 0)
+                throw boost::system::system_error{
+                    errno, boost::system::system_category(), "poll"};
+            if (ready == 0)
+                throw boost::system::system_error{
+                    boost::asio::error::timed_out};
+            buffer += socket.read_some(buffer);
+        }
+    };
+    std::uint32_t size;
+    read(boost::asio::buffer(&size, sizeof(size)));
+    if (size > max_frame_size)
+        throw parse_exception{"vimgcovd frame too large"};
+    std::string payload(size, '\0');
+    read(boost::asio::buffer(payload));
+    return payload;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <boost/asio/local/stream_protocol.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "gcov_json_handler.hpp"
+
+// Messages between vimgcovd and its clients on a Unix stream socket. Every
+// message is a frame, u32 payload size followed by the payload, integers are
+// little-endian and strings are u32 size followed by the bytes.
+//
+// request:  "VGCQ", u32 version, build directory, path
+// response: "VGCR", u32 version, u32 status, then for ok a u32 line count
+//           and (u32 lineno, u8 unexecuted) pairs, for error the message
+constexpr std::uint32_t daemon_protocol_version = 1;
+
+struct coverage_request_t
+{
+    std::string build_dir;
+    std::string path;
+};
+
+struct coverage_response_t
+{
+    enum status_t : std::uint32_t { ok = 0, not_found = 1, error = 2 };
+    status_t status = ok;
+    lines_t lines;
+    std::string message;
+};
+
+std::string encode_request(const coverage_request_t& request);
+coverage_request_t decode_request(std::string_view payload);
+std::string encode_response(const coverage_response_t& response);
+coverage_response_t decode_response(std::string_view payload);
+
+// Blocking frame I/O, errors throw boost::system::system_error, frames
+// larger than max_frame_size throw parse_exception. A nonzero timeout
+// bounds the wait for the whole frame, a peer that doesn't send it in time
+// throws boost::system::system_error with boost::asio::error::timed_out.
+constexpr std::uint32_t max_frame_size = 1u << 28;
+void write_frame(boost::asio::local::stream_protocol::socket& socket,
+                 const std::string& payload);
+std::string read_frame(boost::asio::local::stream_protocol::socket& socket,
+                       std::chrono::milliseconds timeout = {});
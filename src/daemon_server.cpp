@@ -0,0 +1,161 @@
+#include "daemon_server.hpp"
+#include "daemon_protocol.hpp"
+#include <boost/asio/post.hpp>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+using local_socket_t = boost::asio::local::stream_protocol::socket;
+
+void remove_stale_socket(boost::asio::io_context& ctx,
+                         const std::string& socket_path)
+{
+    const boost::asio::local::stream_protocol::endpoint endpoint{socket_path};
+    {
+        local_socket_t probe{ctx};
+        boost::system::error_code ec;
+        probe.connect(endpoint, ec);
+        if (!ec)
+            throw std::runtime_error{"a daemon already listens on " +
+                                     socket_path};
+    }
+    ::unlink(socket_path.c_str());
+}
+
+}
+
+daemon_server_t::daemon_server_t(const std::string& socket_path,
+                                 coverage_index_t& index,
+                                 std::chrono::milliseconds request_timeout)
+    : socket_path_{socket_path}, index_{index},
+      request_timeout_{request_timeout}, acceptor_{ctx_}
+{
+    remove_stale_socket(ctx_, socket_path_);
+    const boost::asio::local::stream_protocol::endpoint endpoint{
+        socket_path_};
+    acceptor_.open(endpoint.protocol());
+    // only the user running the daemon may query it
+    const auto mask = ::umask(0177);
+    boost::system::error_code ec;
+    acceptor_.bind(endpoint, ec);
+    ::umask(mask);
+    if (ec)
+        throw boost::system::system_error{ec, "bind " + socket_path_};
+    acceptor_.listen();
+    accept();
+}
+
+daemon_server_t::~daemon_server_t()
+{
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this] { return active_ == 0; });
+    ::unlink(socket_path_.c_str());
+}
+
+void daemon_server_t::run()
+{
+    ctx_.run();
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this] { return active_ == 0; });
+}
+
+void daemon_server_t::stop()
+{
+    boost::asio::post(ctx_, [this] {
+        boost::system::error_code ec;
+        acceptor_.close(ec);
+    });
+    std::lock_guard lock{mutex_};
+    stopping_ = true;
+    // the blocked reads and writes fail, the serving threads return
+    for (const auto fd : connections_)
+        ::shutdown(fd, SHUT_RDWR);
+}
+
+void daemon_server_t::accept()
+{
+    acceptor_.async_accept([this] (const boost::system::error_code& ec,
+                                   local_socket_t socket) {
+        if (ec == boost::asio::error::operation_aborted)
+            return;
+        if (!ec)
+        {
+            {
+                std::lock_guard lock{mutex_};
+                ++active_;
+            }
+            // the thread owns the fd, nothing of it refers to ctx_ once
+            // active_ dropped and the server may be destroyed
+            std::thread{&daemon_server_t::connection, this,
+                        socket.release()}.detach();
+        }
+        accept();
+    });
+}
+
+void daemon_server_t::connection(int fd)
+{
+    {
+        boost::asio::io_context ctx;
+        local_socket_t socket{ctx, boost::asio::local::stream_protocol{}, fd};
+        bool serving;
+        {
+            std::lock_guard lock{mutex_};
+            serving = !stopping_;
+            if (serving)
+                connections_.insert(fd);
+        }
+        if (serving)
+        {
+            serve(socket);
+            std::lock_guard lock{mutex_};
+            connections_.erase(fd);
+        }
+    }
+    std::lock_guard lock{mutex_};
+    --active_;
+    cv_.notify_all();
+}
+
+void daemon_server_t::serve(local_socket_t& socket)
+{
+    std::string request;
+    try
+    {
+        request = read_frame(socket, request_timeout_);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "vimgcovd: reading request: " << ex.what() << std::endl;
+        return;
+    }
+
+    coverage_response_t response;
+    try
+    {
+        const auto [build_dir, path] = decode_request(request);
+        if (auto lines = index_.lines(build_dir, path))
+            response.lines = std::move(*lines);
+        else
+            response.status = coverage_response_t::not_found;
+    }
+    catch (const std::exception& ex)
+    {
+        response.status = coverage_response_t::error;
+        response.message = ex.what();
+    }
+
+    try
+    {
+        write_frame(socket, encode_response(response));
+    }
+    catch (const std::exception& ex)
+    {
+        // the client went away, e.g. the editor was closed during a sweep
+        std::cerr << "vimgcovd: writing response: " << ex.what() << std::endl;
+    }
+}
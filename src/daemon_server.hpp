@@ -0,0 +1,53 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include "coverage_index.hpp"
+
+// Serves coverage_index_t queries on a Unix socket, see daemon_protocol.hpp.
+// Every connection is one request and one response, handled on its own
+// thread so a query waiting for a sweep doesn't hold back the others.
+// A client that doesn't send its request within request_timeout is
+// dropped. A stale socket file is replaced, a live one (another daemon
+// answering on it) throws std::runtime_error. The socket is created with
+// mode 0600 and removed when the server is destroyed.
+class daemon_server_t
+{
+public:
+    daemon_server_t(const std::string& socket_path, coverage_index_t& index,
+                    std::chrono::milliseconds request_timeout =
+                        std::chrono::seconds{10});
+    ~daemon_server_t();
+
+    daemon_server_t(const daemon_server_t&) = delete;
+    daemon_server_t& operator=(const daemon_server_t&) = delete;
+
+    // accepts connections until stop(), then waits for the running queries
+    void run();
+    // thread safe, also from the handler of a boost::asio::signal_set on
+    // context(). Shuts the open connections down, a query waiting for its
+    // sweep still lets it finish but its response is dropped.
+    void stop();
+    boost::asio::io_context& context() { return ctx_; }
+
+private:
+    void accept();
+    void connection(int fd);
+    void serve(boost::asio::local::stream_protocol::socket& socket);
+
+    std::string socket_path_;
+    coverage_index_t& index_;
+    std::chrono::milliseconds request_timeout_;
+    boost::asio::io_context ctx_;
+    boost::asio::local::stream_protocol::acceptor acceptor_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    unsigned active_ = 0;
+    bool stopping_ = false;
+    // fds of the connections being served, for stop() to shut them down
+    std::set<int> connections_;
+};
@@ -0,0 +1,128 @@
+#include "files_merge.hpp"
+#include "line_merge.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace {
+
+template<typename files_T>
+using entry_t = std::pair<std::string, typename files_T::mapped_type>;
+
+// Runs f(0) ... f(n - 1) on up to threads threads.
+template<typename F>
+void parallel_for(unsigned n, unsigned threads, F f)
+{
+    threads = std::max(1u, std::min(threads, n));
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t)
+        workers.emplace_back([&f, n, t, threads] {
+            for (auto i = t; i < n; i += threads)
+                f(i);
+        });
+    for (unsigned i = 0; i < n; i += threads)
+        f(i);
+    for (auto& worker : workers)
+        worker.join();
+}
+
+// Reduces the entries of one shard, entries of the same path are merged
+// pairwise so every level of the tree is linear in the number of lines.
+template<typename files_T>
+void reduce_shard(std::vector<entry_t<files_T>>& shard)
+{
+    std::stable_sort(shard.begin(), shard.end(),
+                     [] (const auto& a, const auto& b) {
+                         return a.first < b.first;
+                     });
+    auto out = shard.begin();
+    for (auto first = shard.begin(); first != shard.end();)
+    {
+        const auto last = std::find_if(first, shard.end(),
+                                       [first] (const auto& x) {
+                                           return x.first != first->first;
+                                       });
+        for (auto width = 1; width < last - first; width *= 2)
+            for (auto it = first; last - it > width; it += 2 * width)
+                merge_lines(it->second, (it + width)->second, sum_counts{});
+        if (out != first)
+            *out = std::move(*first);
+        ++out;
+        first = last;
+    }
+    shard.erase(out, shard.end());
+}
+
+}
+
+template<typename files_T>
+void merge_files(files_T& into, files_T&& from)
+{
+    for (auto it = from.begin(); it != from.end();)
+    {
+        const auto hint = into.lower_bound(it->first);
+        if (hint != into.end() && hint->first == it->first)
+        {
+            merge_lines(hint->second, it->second, sum_counts{});
+            ++it;
+        }
+        else
+            into.insert(hint, from.extract(it++));
+    }
+    from.clear();
+}
+
+template<typename files_T>
+files_T reduce_files(std::vector<files_T> partials, unsigned threads)
+{
+    partials.erase(std::remove_if(partials.begin(), partials.end(),
+                                  [] (const auto& x) { return x.empty(); }),
+                   partials.end());
+    if (partials.empty())
+        return {};
+    if (partials.size() == 1)
+        return std::move(partials.front());
+
+    threads = std::max(1u, threads);
+    const auto shards = threads;
+    // sharded[partial][shard], filled in parallel over partials
+    std::vector<std::vector<std::vector<entry_t<files_T>>>> sharded(
+        partials.size(),
+        std::vector<std::vector<entry_t<files_T>>>(shards));
+    parallel_for(partials.size(), threads, [&] (unsigned p) {
+        const std::hash<std::string> hash;
+        auto& partial = partials[p];
+        while (!partial.empty())
+        {
+            auto node = partial.extract(partial.begin());
+            sharded[p][hash(node.key()) % shards].emplace_back(
+                std::move(node.key()), std::move(node.mapped()));
+        }
+    });
+
+    std::vector<std::vector<entry_t<files_T>>> reduced(shards);
+    parallel_for(shards, threads, [&] (unsigned s) {
+        auto& shard = reduced[s];
+        for (auto& partial : sharded)
+            std::move(partial[s].begin(), partial[s].end(),
+                      std::back_inserter(shard));
+        reduce_shard<files_T>(shard);
+    });
+
+    std::vector<entry_t<files_T>> entries;
+    for (auto& shard : reduced)
+        std::move(shard.begin(), shard.end(), std::back_inserter(entries));
+    std::sort(entries.begin(), entries.end(),
+              [] (const auto& a, const auto& b) { return a.first < b.first; });
+    files_T rv;
+    for (auto& entry : entries)
+        rv.emplace_hint(rv.end(), std::move(entry));
+    return rv;
+}
+
+template void merge_files(files_t&, files_t&&);
+template void merge_files(counted_files_t&, counted_files_t&&);
+template files_t reduce_files(std::vector<files_t>, unsigned);
+template counted_files_t reduce_files(std::vector<counted_files_t>,
+                                      unsigned);
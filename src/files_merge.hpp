@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+#include "gcov_json_handler.hpp"
+
+// Moves every file of from into into, lines of files present in both are
+// combined the same way reports from different TUs are.
+template<typename files_T>
+void merge_files(files_T& into, files_T&& from);
+
+// Combines partial results built independently (e.g. one per parser
+// thread). Files are sharded by path and every shard is reduced on its own
+// thread with a pairwise tree of linear merges, so headers reported by
+// every partial don't serialize on a single map.
+template<typename files_T>
+files_T reduce_files(std::vector<files_T> partials, unsigned threads);
+
+extern template void merge_files(files_t&, files_t&&);
+extern template void merge_files(counted_files_t&, counted_files_t&&);
+extern template files_t reduce_files(std::vector<files_t>, unsigned);
+extern template counted_files_t reduce_files(std::vector<counted_files_t>,
+                                             unsigned);
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <map>
 #include <vector>
 #include <string>
@@ -8,6 +9,9 @@
 using lines_t = std::vector<std::tuple<unsigned/*lineno*/,
                                        bool/*unexecuted*/>>;
 using files_t = std::map<std::string /*path*/, lines_t>;
+using counted_lines_t = std::vector<std::tuple<unsigned/*lineno*/,
+                                               std::uint64_t/*count*/>>;
+using counted_files_t = std::map<std::string /*path*/, counted_lines_t>;
 using filename_selector_t = std::function<bool(const std::string&)>;
 
 void parse_gcov_json(files_t& out,
@@ -16,6 +20,16 @@ void parse_gcov_json(files_t& out,
 void parse_llvm_json(files_t& out,
                      const std::string& buf,
                      filename_selector_t filename_selector);
+// Same as above but keeps execution counts, summed (saturating) when the
+// same line is reported by several TUs or llvm functions (instantiations).
+// Within one llvm file entry a line counts the larger of its segments and
+// that sum over the functions.
+void parse_gcov_json(counted_files_t& out,
+                     const std::string& buf,
+                     filename_selector_t filename_selector);
+void parse_llvm_json(counted_files_t& out,
+                     const std::string& buf,
+                     filename_selector_t filename_selector);
 
 struct parse_exception : std::runtime_error
 {
@@ -0,0 +1,235 @@
+#pragma once
+#include <string_view>
+#include "gcov_json_handler.hpp"
+#include "line_merge.hpp"
+#include "rapidjson/document.h"
+#include "rapidjson/error/en.h"
+
+#ifndef TRACE
+#ifdef spdlog_FOUND
+#include <spdlog/spdlog.h>
+#define TRACE(...) SPDLOG_TRACE(__VA_ARGS__)
+#else
+#define TRACE(...) (void)0
+#endif
+#endif
+
+// The gcov and llvm-cov export parsers as templates over the output map
+// (files_t, counted_files_t or any map from path to lines_t/counted_lines_t)
+// and the filename selector (see selectors.hpp), which is called with a
+// std::string_view for every file entry and llvm function. Keeping both
+// known at compile time lets the per-record work inline into the parser
+// loops; the overloads in gcov_json_handler.hpp wrap these for a type
+// erased filename_selector_t.
+
+inline rapidjson::Document parse_json_document(const std::string& buf)
+{
+    rapidjson::Document doc;
+    doc.Parse(buf.c_str());
+
+    if (doc.HasParseError())
+        throw parse_exception{
+            "JSON parse error: " + std::string(rapidjson::GetParseError_En(
+            doc.GetParseError())) + " (offset " + std::to_string(
+            doc.GetErrorOffset()) + ")"};
+    return doc;
+}
+
+template<typename files_T, typename selector_T>
+void parse_gcov_json(files_T& out,
+                     const std::string& buf,
+                     const selector_T& filename_selector)
+{
+    auto doc = parse_json_document(buf);
+
+    if (doc.HasParseError())
+        throw parse_exception{
+            "JSON parse error: " + std::string(rapidjson::GetParseError_En(
+            doc.GetParseError())) + " (offset " + std::to_string(
+            doc.GetErrorOffset()) + ")"};
+
+    if (!doc.IsObject())
+        throw parse_exception{"JSON root is not an object"};
+
+    if (!doc.HasMember("files") || !doc["files"].IsArray())
+        throw parse_exception{"JSON does not contain a valid 'files' array"};
+
+    const auto& files = doc["files"];
+    for (const auto& file : files.GetArray())
+    {
+        if (!file.IsObject())
+            throw parse_exception{"File entry isn't an object"};
+        if (!file.HasMember("file") || !file["file"].IsString())
+            throw parse_exception{
+                "File entry missing 'file' string attribute"};
+
+        const std::string_view filename{file["file"].GetString(),
+                                        file["file"].GetStringLength()};
+        if (!filename_selector(filename))
+        {
+            TRACE("Skipping file: {}", filename);
+            continue;
+        }
+
+        auto [itf, _] = out.try_emplace(std::string{filename});
+        auto& lines_out = itf->second;
+        typename files_T::mapped_type pending;
+
+        if (!file.HasMember("lines") || !file["lines"].IsArray())
+            throw parse_exception{
+                "File entry for '" + std::string(filename) +
+                "' missing 'lines' array"};
+
+        const auto &lines = file["lines"];
+        for (const auto &line : lines.GetArray())
+        {
+            if (!line.IsObject())
+                throw parse_exception{"Line entry isn't an object"};
+            if (!line.HasMember("line_number") || !line["line_number"].IsInt())
+                throw parse_exception{
+                    "Line entry in file '" + std::string(filename) +
+                    "' missing 'line_number' integer attribute"};
+            const auto line_number = line["line_number"].GetUint();
+
+            if (!line.HasMember("count") || !line["count"].IsUint64())
+                throw parse_exception{
+                    "Line entry in file '" + std::string(filename) +
+                    "' missing 'count' integer attribute"};
+            if (!line.HasMember("unexecuted_block") ||
+                !line["unexecuted_block"].IsBool())
+                throw parse_exception{"Unexecuted block isn't boolean"};
+            auto unexecute_block = line["unexecuted_block"].GetBool();
+
+            const auto count = line["count"].GetUint64();
+            unexecute_block &= !count;
+            add_line(pending, line_number, count, unexecute_block);
+        }
+        merge_lines(lines_out, pending, sum_counts{});
+    }
+}
+
+template<typename files_T, typename selector_T>
+void parse_llvm_json(files_T& out,
+                     const std::string& buf,
+                     const selector_T& filename_selector)
+{
+    auto doc = parse_json_document(buf);
+
+    if (!doc.IsObject())
+        throw parse_exception{"JSON root is not an object"};
+
+    if (!doc.HasMember("data") || !doc["data"].IsArray())
+        throw parse_exception{"JSON does not contain a valid 'data' object"};
+
+    for (const auto& data : doc["data"].GetArray())
+    {
+        if (!data.IsObject() ||
+            !data.HasMember("files") ||
+            !data["files"].IsArray()
+        )
+            throw parse_exception{"JSON does not contain a valid 'files' array"};
+        const auto& files = data["files"].GetArray();
+
+        for (const auto& file : files)
+        {
+            if (!file.HasMember("filename") || !file["filename"].IsString())
+                throw parse_exception{
+                    "File object without 'filename' attribute"};
+            const std::string_view filename{
+                file["filename"].GetString(),
+                file["filename"].GetStringLength()};
+
+            if (!filename_selector(filename))
+            {
+                TRACE("Skipping file: {}", filename);
+                continue;
+            }
+
+            auto [itf, _] = out.try_emplace(std::string{filename});
+            auto& lines_out = itf->second;
+            typename files_T::mapped_type pending;
+
+            if (!file.HasMember("segments") || !file["segments"].IsArray())
+                throw parse_exception{"File object without 'segments' array"};
+
+            const auto& segments = file["segments"].GetArray();
+            for (const auto& segment_json : segments)
+            {
+                if (!segment_json.IsArray())
+                    throw parse_exception{"Segment isn't an array"};
+                const auto& segment = segment_json.GetArray();
+                enum SegmentIndices
+                {
+                    LINE, COL, COUNT, HAS_COUNT, IS_REGION_ENTRY, IS_GAP_REGION
+                };
+                if (segment.Size() < 6 ||
+                    !segment[LINE].IsUint() ||
+                    !segment[COUNT].IsUint64() ||
+                    !segment[HAS_COUNT].IsBool() ||
+                    !segment[IS_REGION_ENTRY].IsBool() ||
+                    !segment[IS_GAP_REGION].IsBool()
+                )
+                    throw parse_exception{"Invalid segment array"};
+                if (!segment[HAS_COUNT].GetBool() ||
+                    !segment[IS_REGION_ENTRY].GetBool() ||
+                    segment[IS_GAP_REGION].GetBool()
+                )
+                    continue;
+                const auto count = segment[COUNT].GetUint64();
+                add_line(pending, segment[LINE].GetUint(), count, !count);
+            }
+
+            if (!file.HasMember("functions") || !file["functions"].IsArray())
+                throw parse_exception{"File object without 'functions' array"};
+            const auto& functions = file["functions"].GetArray();
+            // each function (one per template/generic instantiation) adds
+            // its executions of a line, nested regions of one function
+            // count the same executions
+            typename files_T::mapped_type function_lines;
+            typename files_T::mapped_type functions_lines;
+            for (const auto& function : functions)
+            {
+                if (!function.HasMember("filename") ||
+                    !function["filename"].IsString())
+                    throw parse_exception{
+                        "Function object without 'filename' string"};
+                if (!filename_selector(std::string_view{
+                        function["filename"].GetString(),
+                        function["filename"].GetStringLength()}))
+                    continue;
+                if (!function.HasMember("regions") ||
+                    !function["regions"].IsArray()
+                )
+                    throw parse_exception{
+                        "Function object without 'regions' array"};
+                const auto& regions = function["regions"].GetArray();
+                for (const auto& region_json : regions)
+                {
+                    enum RegionIndices
+                    {
+                        LINE_START, COLUMN_START, LINE_END, COLUMN_END,
+                        EXECUTION_COUNT, FILE_ID, EXPANDED_FILE_ID,
+                    };
+
+                    if (!region_json.IsArray())
+                        throw parse_exception{"Region is not an array"};
+                    const auto& region = region_json.GetArray();
+                    if (region.Size() < 7 ||
+                        !region[LINE_START].IsUint() ||
+                        !region[EXECUTION_COUNT].IsUint64()
+                    )
+                        throw parse_exception{"Invalid region array"};
+                    const auto count = region[EXECUTION_COUNT].GetUint64();
+                    add_line(function_lines, region[LINE_START].GetUint(),
+                             count, !count);
+                }
+                merge_lines(functions_lines, function_lines, max_counts{});
+                function_lines.clear();
+            }
+            // the segments already combine the instantiations
+            pending.insert(pending.end(), functions_lines.begin(),
+                           functions_lines.end());
+            merge_lines(lines_out, pending, max_counts{});
+        }
+    }
+}
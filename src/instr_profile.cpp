@@ -0,0 +1,212 @@
+#include "instr_profile.hpp"
+#include "binary_reader.hpp"
+#include "line_merge.hpp"
+#include "md5.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace {
+
+constexpr std::uint64_t raw_magic = 0xff6c70726f667281;
+constexpr std::uint64_t indexed_magic = 0x8169666f72706cff;
+constexpr std::uint64_t version_mask = 0xffffffff;
+constexpr std::uint64_t csir_prof_mask = std::uint64_t{1} << 57;
+constexpr std::uint64_t debug_info_correlate_mask = std::uint64_t{1} << 59;
+constexpr std::uint64_t byte_coverage_mask = std::uint64_t{1} << 60;
+
+void add_counters(profile_counters_t& out,
+                  function_key_t key,
+                  std::vector<std::uint64_t> counters)
+{
+    auto [it, inserted] = out.try_emplace(key, std::move(counters));
+    if (inserted)
+        return;
+    // a different number of counters means a stale profile, keep the first
+    if (it->second.size() != counters.size())
+        return;
+    for (std::size_t i = 0; i < counters.size(); ++i)
+        sum_counts{}(it->second[i], counters[i]);
+}
+
+void skip_summary(binary_reader_t& reader)
+{
+    const auto num_fields = reader.read<std::uint64_t>();
+    const auto num_cutoffs = reader.read<std::uint64_t>();
+    if (num_fields > reader.remaining() / 8 ||
+        num_cutoffs > reader.remaining() / 24)
+        throw parse_exception{"Invalid profile summary"};
+    reader.skip(num_fields * 8 + num_cutoffs * 24);
+}
+
+}
+
+void read_profraw(profile_counters_t& out, std::string_view data)
+{
+    binary_reader_t reader{data};
+    if (reader.read<std::uint64_t>() != raw_magic)
+        throw parse_exception{"Not a 64-bit little-endian raw profile"};
+    const auto version_field = reader.read<std::uint64_t>();
+    const auto version = version_field & version_mask;
+    if (version < 5 || version > 10)
+        throw parse_exception{"Unsupported raw profile version " +
+                              std::to_string(version)};
+    if (version_field & debug_info_correlate_mask)
+        throw parse_exception{"Debug info correlated raw profiles "
+                              "aren't supported"};
+
+    const auto binary_ids_size = version >= 6 ?
+        reader.read<std::uint64_t>() : 0;
+    const auto num_data = reader.read<std::uint64_t>();
+    const auto padding_before_counters = reader.read<std::uint64_t>();
+    const auto num_counters = reader.read<std::uint64_t>();
+    reader.read<std::uint64_t>(); // padding after counters
+    if (version >= 9)
+    {
+        reader.read<std::uint64_t>(); // bitmap bytes
+        reader.read<std::uint64_t>(); // padding after bitmap bytes
+    }
+    reader.read<std::uint64_t>(); // names size
+    const auto counters_delta = reader.read<std::uint64_t>();
+    if (version >= 9)
+        reader.read<std::uint64_t>(); // bitmap delta
+    reader.read<std::uint64_t>(); // names delta
+    if (version >= 10)
+    {
+        reader.read<std::uint64_t>(); // vtables
+        reader.read<std::uint64_t>(); // vtable names size
+    }
+    reader.read<std::uint64_t>(); // value kind last
+
+    reader.skip(binary_ids_size);
+    const std::uint64_t record_size = version >= 9 ? 64 : 48;
+    if (num_data > reader.remaining() / record_size)
+        throw parse_exception{"Raw profile data records out of bounds"};
+    binary_reader_t records{reader.read_bytes(num_data * record_size)};
+    reader.skip(padding_before_counters);
+    const std::uint64_t counter_size =
+        version_field & byte_coverage_mask ? 1 : 8;
+    if (num_counters > reader.remaining() / counter_size)
+        throw parse_exception{"Raw profile counters out of bounds"};
+    const auto counters = reader.read_bytes(num_counters * counter_size);
+
+    for (std::uint64_t i = 0; i < num_data; ++i)
+    {
+        const auto name_ref = records.read<std::uint64_t>();
+        const auto func_hash = records.read<std::uint64_t>();
+        const auto counter_ptr = records.read<std::uint64_t>();
+        records.skip(version >= 9 ? 24 : 16); // bitmap, function, values
+        const auto func_counters = records.read<std::uint32_t>();
+        records.skip(record_size - (version >= 9 ? 52 : 44));
+
+        // since version 7 counter pointers are relative to their record
+        const auto offset = version >= 7 ?
+            counter_ptr + i * record_size - counters_delta :
+            counter_ptr - counters_delta;
+        if (offset % counter_size ||
+            offset / counter_size > num_counters ||
+            func_counters > num_counters - offset / counter_size)
+            throw parse_exception{"Raw profile counter offset out of bounds"};
+
+        std::vector<std::uint64_t> values(func_counters);
+        binary_reader_t reader{counters.substr(offset)};
+        for (auto& value : values)
+            value = counter_size == 1 ?
+                // single byte counters are cleared when covered
+                reader.read<std::uint8_t>() == 0 :
+                reader.read<std::uint64_t>();
+        add_counters(out, {name_ref, func_hash}, std::move(values));
+    }
+}
+
+void read_profdata(profile_counters_t& out, std::string_view data)
+{
+    binary_reader_t reader{data};
+    if (reader.read<std::uint64_t>() != indexed_magic)
+        throw parse_exception{"Not an indexed profile"};
+    const auto version_field = reader.read<std::uint64_t>();
+    const auto version = version_field & version_mask;
+    if (version < 3 || version > 12)
+        throw parse_exception{"Unsupported indexed profile version " +
+                              std::to_string(version)};
+    reader.read<std::uint64_t>(); // unused
+    if (reader.read<std::uint64_t>() != 0)
+        throw parse_exception{"Unsupported indexed profile hash type"};
+    const auto hash_offset = reader.read<std::uint64_t>();
+    // memprof, binary ids, temporal traces and vtable names offsets
+    for (const auto since : {8u, 9u, 10u, 12u})
+        if (version >= since)
+            reader.read<std::uint64_t>();
+    if (version >= 4)
+    {
+        skip_summary(reader);
+        if (version_field & csir_prof_mask)
+            skip_summary(reader);
+    }
+
+    if (hash_offset > data.size())
+        throw parse_exception{"Indexed profile hash table out of bounds"};
+    binary_reader_t table{data.substr(hash_offset)};
+    table.read<std::uint64_t>(); // buckets
+    auto entries = table.read<std::uint64_t>();
+
+    // the payload right after the header is a sequence of non-empty
+    // buckets: u16 items, then per item hash, key and data
+    for (std::uint16_t items = 0; entries; --entries, --items)
+    {
+        if (!items)
+            items = reader.read<std::uint16_t>();
+        if (!items)
+            throw parse_exception{"Empty indexed profile bucket"};
+        reader.read<std::uint64_t>(); // hash
+        const auto key_size = reader.read<std::uint64_t>();
+        const auto data_size = reader.read<std::uint64_t>();
+        if (key_size > reader.remaining() ||
+            data_size > reader.remaining() - key_size)
+            throw parse_exception{"Indexed profile record out of bounds"};
+        const auto name_ref = md5_hash(reader.read_bytes(key_size));
+        binary_reader_t record{reader.read_bytes(data_size)};
+        while (!record.empty())
+        {
+            const auto func_hash = record.read<std::uint64_t>();
+            const auto num_counters = record.read<std::uint64_t>();
+            if (num_counters > record.remaining() / 8)
+                throw parse_exception{"Indexed profile counters out of "
+                                      "bounds"};
+            std::vector<std::uint64_t> counters(num_counters);
+            for (auto& counter : counters)
+                counter = record.read<std::uint64_t>();
+            if (version > 10)
+            {
+                const auto bitmap_bytes = record.read<std::uint64_t>();
+                if (bitmap_bytes > record.remaining() / 8)
+                    throw parse_exception{"Indexed profile bitmap out of "
+                                          "bounds"};
+                record.skip(bitmap_bytes * 8);
+            }
+            // value profile data, its size includes the size field
+            const auto value_data_size = record.read<std::uint32_t>();
+            if (value_data_size < 4)
+                throw parse_exception{"Invalid indexed profile value data"};
+            record.skip(value_data_size - 4);
+            add_counters(out, {name_ref, func_hash}, std::move(counters));
+        }
+    }
+}
+
+void read_instr_profile(profile_counters_t& out, const std::string& path)
+{
+    namespace bip = boost::interprocess;
+    // an interrupted test can leave an empty profile behind
+    if (boost::filesystem::file_size(path) == 0)
+        return;
+    const bip::file_mapping file{path.c_str(), bip::read_only};
+    const bip::mapped_region region{file, bip::read_only};
+    const std::string_view data{static_cast<const char*>(region.get_address()),
+                                region.get_size()};
+    binary_reader_t reader{data};
+    if (reader.read<std::uint64_t>() == indexed_magic)
+        read_profdata(out, data);
+    else
+        read_profraw(out, data);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Execution counters of every instrumented function, keyed by the MD5 of its
+// name (NameRef) and its structural hash (FuncHash).
+using function_key_t = std::pair<std::uint64_t /*name_ref*/,
+                                 std::uint64_t /*func_hash*/>;
+using profile_counters_t = std::map<function_key_t,
+                                    std::vector<std::uint64_t>>;
+
+// Adds the counters of a 64-bit little-endian raw profile (raw versions 5 to
+// 10) or an indexed profile (versions 3 to 12). Counters of a function seen
+// in several profiles are summed like llvm-profdata merge does.
+void read_instr_profile(profile_counters_t& out, const std::string& path);
+void read_profraw(profile_counters_t& out, std::string_view data);
+void read_profdata(profile_counters_t& out, std::string_view data);
@@ -0,0 +1,73 @@
+#include "job_ranking.hpp"
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cctype>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+unsigned name_similarity(const std::string& gcno_name, const fs::path& source)
+{
+    const auto name = source.filename().string();
+    const auto stem = source.stem().string();
+    if (gcno_name == name)
+        return 3;
+    if (gcno_name == stem)
+        return 2;
+    // libtool and automake prefix objects with the target name
+    if (gcno_name.size() > stem.size() &&
+        gcno_name.compare(gcno_name.size() - stem.size(), stem.size(),
+                          stem) == 0 &&
+        !std::isalnum(static_cast<unsigned char>(
+            gcno_name[gcno_name.size() - stem.size() - 1])))
+        return 1;
+    return 0;
+}
+
+unsigned shared_directories(const fs::path& gcno, const fs::path& source)
+{
+    auto g = gcno.parent_path();
+    auto s = source.parent_path();
+    unsigned shared = 0;
+    while (!g.empty() && !s.empty() && g.filename() == s.filename() &&
+           g.filename() != "/")
+    {
+        ++shared;
+        g = g.parent_path();
+        s = s.parent_path();
+    }
+    return shared;
+}
+
+}
+
+unsigned rank_by_similarity(std::deque<std::string>& gcnos,
+                            const std::string& source)
+{
+    const fs::path source_path{source};
+    std::vector<std::tuple<unsigned, unsigned, std::size_t>> ranks;
+    ranks.reserve(gcnos.size());
+    for (std::size_t i = 0; i < gcnos.size(); ++i)
+    {
+        const fs::path gcno{gcnos[i]};
+        const auto name = gcno.stem().string();
+        const auto similarity = name_similarity(name, source_path);
+        ranks.emplace_back(similarity,
+                           similarity ? shared_directories(gcno, source_path)
+                                      : 0,
+                           i);
+    }
+    std::stable_sort(ranks.begin(), ranks.end(),
+                     [] (const auto& a, const auto& b) {
+                         return std::tie(std::get<0>(a), std::get<1>(a)) <
+                             std::tie(std::get<0>(b), std::get<1>(b));
+                     });
+    std::deque<std::string> ranked;
+    for (const auto& rank : ranks)
+        ranked.push_back(std::move(gcnos[std::get<2>(rank)]));
+    gcnos.swap(ranked);
+    return ranks.empty() ? 0 : std::get<0>(ranks.back());
+}
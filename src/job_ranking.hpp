@@ -0,0 +1,13 @@
+#pragma once
+#include <deque>
+#include <string>
+
+// Orders gcno files by how likely they were built from source, most likely
+// last since process_files takes jobs from the back. foo.cpp.gcno (CMake)
+// ranks above foo.gcno (make), above a prefixed libtool-foo.gcno, ties are
+// broken by the number of trailing directories shared with source (CMake
+// mirrors the source tree under the target directory). The order of
+// unrelated gcnos is kept. Returns the name similarity of the gcno ranked
+// last, 0 when no gcno's name matches source (e.g. for a header).
+unsigned rank_by_similarity(std::deque<std::string>& gcnos,
+                            const std::string& source);
@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include "gcov_json_handler.hpp"
+
+// Combines two reports of the same line coming from different TUs.
+struct sum_counts
+{
+    void operator()(bool& unexecuted, bool other) const
+    {
+        unexecuted &= other;
+    }
+    void operator()(std::uint64_t& count, std::uint64_t other) const
+    {
+        if (__builtin_add_overflow(count, other, &count))
+            count = std::numeric_limits<std::uint64_t>::max();
+    }
+};
+
+// Combines two reports of the same line within one llvm file entry, where
+// segments and regions describe the same executions.
+struct max_counts
+{
+    void operator()(bool& unexecuted, bool other) const
+    {
+        unexecuted &= other;
+    }
+    void operator()(std::uint64_t& count, std::uint64_t other) const
+    {
+        count = std::max(count, other);
+    }
+};
+
+inline void add_line(lines_t& pending, unsigned line_number, std::uint64_t,
+                     bool unexecute_block)
+{
+    pending.emplace_back(line_number, unexecute_block);
+}
+
+inline void add_line(counted_lines_t& pending, unsigned line_number,
+                     std::uint64_t count, bool)
+{
+    pending.emplace_back(line_number, count);
+}
+
+// Merges the lines collected from one file entry into the result in linear
+// time. Headers included by every TU mostly report the same set of lines,
+// in that case the counters are combined in place without reallocating.
+template<typename lines_T, typename collapse_T>
+void merge_lines(lines_T& lines_out, lines_T& pending, collapse_T collapse)
+{
+    const sum_counts combine;
+    const auto by_line = [] (const auto& a, const auto& b) {
+        return std::get<0>(a) < std::get<0>(b);
+    };
+    if (!std::is_sorted(pending.begin(), pending.end(), by_line))
+        std::sort(pending.begin(), pending.end(), by_line);
+
+    auto last = pending.begin();
+    for (auto it = pending.begin(); it != pending.end(); ++it)
+    {
+        if (last != pending.begin() &&
+            std::get<0>(*std::prev(last)) == std::get<0>(*it))
+            collapse(std::get<1>(*std::prev(last)), std::get<1>(*it));
+        else
+            *last++ = *it;
+    }
+    pending.erase(last, pending.end());
+
+    if (lines_out.empty())
+    {
+        lines_out.swap(pending);
+        return;
+    }
+
+    if (std::includes(lines_out.begin(), lines_out.end(),
+                      pending.begin(), pending.end(), by_line))
+    {
+        auto itl = lines_out.begin();
+        for (const auto& line : pending)
+        {
+            while (by_line(*itl, line))
+                ++itl;
+            combine(std::get<1>(*itl), std::get<1>(line));
+        }
+        return;
+    }
+
+    lines_T merged;
+    merged.reserve(lines_out.size() + pending.size());
+    auto itl = lines_out.begin();
+    auto itp = pending.begin();
+    while (itl != lines_out.end() && itp != pending.end())
+    {
+        if (by_line(*itl, *itp))
+            merged.push_back(*itl++);
+        else if (by_line(*itp, *itl))
+            merged.push_back(*itp++);
+        else
+        {
+            merged.push_back(*itl++);
+            combine(std::get<1>(merged.back()), std::get<1>(*itp++));
+        }
+    }
+    merged.insert(merged.end(), itl, lines_out.end());
+    merged.insert(merged.end(), itp, pending.end());
+    lines_out.swap(merged);
+}
@@ -0,0 +1,337 @@
+#include "llvm_coverage.hpp"
+#include "binary_reader.hpp"
+#include "instr_profile.hpp"
+#include "line_merge.hpp"
+#include "md5.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <elf.h>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <zlib.h>
+
+namespace {
+
+// CovMapVersion::Version4, the first one with a separate __llvm_covfun
+constexpr std::uint32_t first_covmap_version = 3;
+// CovMapVersion::Version6, filenames are relative to a compilation dir
+constexpr std::uint32_t compilation_dir_version = 5;
+constexpr std::uint32_t last_covmap_version = 6;
+
+struct sections_t
+{
+    std::string_view covmap;
+    std::string_view covfun;
+};
+
+sections_t find_sections(std::string_view elf)
+{
+    sections_t sections;
+    Elf64_Ehdr header;
+    if (elf.size() < sizeof(header) ||
+        elf.compare(0, SELFMAG, ELFMAG) != 0 ||
+        elf[EI_CLASS] != ELFCLASS64 ||
+        elf[EI_DATA] != ELFDATA2LSB)
+        return sections;
+    std::memcpy(&header, elf.data(), sizeof(header));
+
+    const auto section = [&] (std::size_t i) {
+        Elf64_Shdr rv;
+        if (header.e_shentsize < sizeof(rv) ||
+            header.e_shoff > elf.size() ||
+            i >= (elf.size() - header.e_shoff) / header.e_shentsize)
+            throw parse_exception{"ELF section header out of bounds"};
+        std::memcpy(&rv, elf.data() + header.e_shoff + i * header.e_shentsize,
+                    sizeof(rv));
+        return rv;
+    };
+    const auto contents = [&] (const Elf64_Shdr& shdr) -> std::string_view {
+        if (shdr.sh_type == SHT_NOBITS)
+            return {};
+        if (shdr.sh_offset > elf.size() ||
+            shdr.sh_size > elf.size() - shdr.sh_offset)
+            throw parse_exception{"ELF section out of bounds"};
+        return elf.substr(shdr.sh_offset, shdr.sh_size);
+    };
+
+    if (!header.e_shoff)
+        return sections;
+    std::size_t count = header.e_shnum;
+    std::size_t names_index = header.e_shstrndx;
+    if (!count)
+        count = section(0).sh_size;
+    if (names_index == SHN_XINDEX)
+        names_index = section(0).sh_link;
+    const auto names = contents(section(names_index));
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto shdr = section(i);
+        if (shdr.sh_name >= names.size())
+            continue;
+        const auto name = names.substr(shdr.sh_name,
+                                       names.find('\0', shdr.sh_name) -
+                                       shdr.sh_name);
+        if (name == "__llvm_covmap")
+            sections.covmap = contents(shdr);
+        else if (name == "__llvm_covfun")
+            sections.covfun = contents(shdr);
+    }
+    return sections;
+}
+
+std::vector<std::string> read_filenames(std::string_view blob,
+                                        std::uint32_t version)
+{
+    binary_reader_t reader{blob};
+    const auto count = reader.read_uleb128();
+    const auto uncompressed_size = reader.read_uleb128();
+    const auto compressed_size = reader.read_uleb128();
+    std::string uncompressed;
+    if (compressed_size)
+    {
+        uncompressed.resize(uncompressed_size);
+        auto size = static_cast<uLongf>(uncompressed_size);
+        const auto compressed = reader.read_bytes(compressed_size);
+        if (uncompress(reinterpret_cast<Bytef*>(uncompressed.data()), &size,
+                       reinterpret_cast<const Bytef*>(compressed.data()),
+                       compressed.size()) != Z_OK ||
+            size != uncompressed_size)
+            throw parse_exception{"Invalid compressed coverage filenames"};
+        reader = binary_reader_t{uncompressed};
+    }
+
+    namespace fs = boost::filesystem;
+    std::vector<std::string> filenames;
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+        const auto size = reader.read_uleb128();
+        if (size > reader.remaining())
+            throw parse_exception{"Coverage filename out of bounds"};
+        const fs::path filename{std::string{reader.read_bytes(size)}};
+        // the first filename is the compilation dir others are relative to
+        if (version >= compilation_dir_version && i &&
+            filename.is_relative() && !filenames.front().empty())
+            filenames.push_back(
+                (fs::path{filenames.front()} / filename)
+                    .lexically_normal().string());
+        else
+            filenames.push_back(filename.string());
+    }
+    return filenames;
+}
+
+// counter expressions of one function, evaluated lazily
+class counter_values_t
+{
+public:
+    counter_values_t(const std::vector<std::uint64_t>& counters,
+                     std::vector<std::pair<std::uint64_t,
+                                           std::uint64_t>> expressions)
+        : counters_{counters}, expressions_{std::move(expressions)},
+          values_(expressions_.size()), visiting_(expressions_.size()) {}
+
+    std::uint64_t operator()(std::uint64_t counter)
+    {
+        const auto id = counter >> 2;
+        switch (counter & 3)
+        {
+        case 0:
+            return 0;
+        case 1:
+            return id < counters_.size() ? counters_[id] : 0;
+        }
+        if (id >= expressions_.size())
+            throw parse_exception{"Coverage expression out of bounds"};
+        if (values_[id])
+            return *values_[id];
+        if (visiting_[id])
+            throw parse_exception{"Recursive coverage expression"};
+        visiting_[id] = true;
+        const auto lhs = (*this)(expressions_[id].first);
+        const auto rhs = (*this)(expressions_[id].second);
+        auto value = lhs;
+        if ((counter & 3) == 3)
+            sum_counts{}(value, rhs);
+        else
+            value = lhs > rhs ? lhs - rhs : 0;
+        values_[id] = value;
+        return value;
+    }
+
+private:
+    const std::vector<std::uint64_t>& counters_;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> expressions_;
+    std::vector<std::optional<std::uint64_t>> values_;
+    std::vector<bool> visiting_;
+};
+
+template<typename files_T>
+void read_function(std::map<std::string,
+                            typename files_T::mapped_type>& pending,
+                   std::string_view mapping,
+                   const std::vector<std::string>& filenames,
+                   const std::vector<std::uint64_t>& counters,
+                   const filename_selector_t& filename_selector)
+{
+    using lines_T = typename files_T::mapped_type;
+    // lines of this function per file, nested regions count the same
+    // executions and are collapsed before being summed into pending with
+    // the other functions (instantiations) covering the file
+    std::map<lines_T*, lines_T> function_lines;
+    binary_reader_t reader{mapping};
+    std::vector<lines_T*> files(reader.read_uleb128());
+    for (auto& file : files)
+    {
+        const auto index = reader.read_uleb128();
+        if (index >= filenames.size())
+            throw parse_exception{"Coverage filename index out of bounds"};
+        if (filename_selector(filenames[index]))
+            file = &pending[filenames[index]];
+    }
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> expressions(
+        reader.read_uleb128());
+    for (auto& [lhs, rhs] : expressions)
+    {
+        lhs = reader.read_uleb128();
+        rhs = reader.read_uleb128();
+    }
+    counter_values_t counter_value{counters, std::move(expressions)};
+
+    for (auto* file : files)
+    {
+        unsigned line_start = 0;
+        for (auto regions = reader.read_uleb128(); regions; --regions)
+        {
+            auto header = reader.read_uleb128();
+            bool code = true;
+            if (!(header & 3))
+            {
+                const auto kind = header >> 3;
+                code = !(header & 4) && kind == 0;
+                switch (header & 4 ? 0 : kind)
+                {
+                case 0: // code region with a zero counter or expansion
+                case 2: // skipped
+                    break;
+                case 4: // branch
+                    reader.read_uleb128();
+                    reader.read_uleb128();
+                    break;
+                case 5: // mc/dc decision
+                    reader.read_uleb128();
+                    reader.read_uleb128();
+                    break;
+                case 6: // mc/dc branch
+                    for (int i = 0; i < 5; ++i)
+                        reader.read_uleb128();
+                    break;
+                default:
+                    throw parse_exception{"Unknown coverage region kind " +
+                                          std::to_string(kind)};
+                }
+            }
+            line_start += reader.read_uleb128();
+            reader.read_uleb128(); // column start
+            reader.read_uleb128(); // lines
+            const auto column_end = reader.read_uleb128();
+            const bool gap = column_end & (std::uint64_t{1} << 31);
+            if (!file || !code || gap)
+                continue;
+            const auto count = counter_value(header);
+            add_line(function_lines[file], line_start, count, !count);
+        }
+    }
+    for (auto& [file, lines] : function_lines)
+        merge_lines(*file, lines, max_counts{});
+}
+
+template<typename files_T>
+void read_coverage_mapping(std::map<std::string,
+                                    typename files_T::mapped_type>& pending,
+                           std::set<function_key_t>& seen,
+                           const std::string& executable,
+                           const profile_counters_t& counters,
+                           const filename_selector_t& filename_selector)
+{
+    namespace bip = boost::interprocess;
+    if (boost::filesystem::file_size(executable) == 0)
+        return;
+    const bip::file_mapping file{executable.c_str(), bip::read_only};
+    const bip::mapped_region region{file, bip::read_only};
+    const auto sections = find_sections({
+        static_cast<const char*>(region.get_address()), region.get_size()});
+    if (sections.covmap.empty())
+        return;
+
+    std::unordered_map<std::uint64_t, std::vector<std::string>> filenames;
+    binary_reader_t covmap{sections.covmap};
+    while (!covmap.empty())
+    {
+        covmap.read<std::uint32_t>(); // function records, always 0
+        const auto filenames_size = covmap.read<std::uint32_t>();
+        covmap.read<std::uint32_t>(); // coverage size, always 0
+        const auto version = covmap.read<std::uint32_t>();
+        if (version < first_covmap_version || version > last_covmap_version)
+            throw parse_exception{"Unsupported coverage mapping version " +
+                                  std::to_string(version + 1)};
+        const auto blob = covmap.read_bytes(filenames_size);
+        filenames.emplace(md5_hash(blob), read_filenames(blob, version));
+        covmap.align(8);
+    }
+
+    static const std::vector<std::uint64_t> no_counters;
+    binary_reader_t covfun{sections.covfun};
+    while (!covfun.empty())
+    {
+        const auto name_ref = covfun.read<std::uint64_t>();
+        const auto size = covfun.read<std::uint32_t>();
+        const auto func_hash = covfun.read<std::uint64_t>();
+        const auto filenames_ref = covfun.read<std::uint64_t>();
+        const auto mapping = covfun.read_bytes(size);
+        covfun.align(8);
+        if (!seen.insert({name_ref, func_hash}).second)
+            continue;
+        const auto it = filenames.find(filenames_ref);
+        if (it == filenames.end())
+            throw parse_exception{"Coverage function with unknown filenames"};
+        const auto counter = counters.find({name_ref, func_hash});
+        read_function<files_T>(pending, mapping, it->second,
+                               counter == counters.end() ?
+                                   no_counters : counter->second,
+                               filename_selector);
+    }
+}
+
+}
+
+template<typename files_T>
+files_T read_llvm_coverage(const std::deque<std::string>& executables,
+                           const std::deque<std::string>& profiles,
+                           filename_selector_t filename_selector)
+{
+    profile_counters_t counters;
+    for (const auto& profile : profiles)
+        read_instr_profile(counters, profile);
+
+    std::map<std::string, typename files_T::mapped_type> pending;
+    std::set<function_key_t> seen;
+    for (const auto& executable : executables)
+        read_coverage_mapping<files_T>(pending, seen, executable, counters,
+                                       filename_selector);
+
+    files_T out;
+    for (auto& [filename, lines] : pending)
+        if (!lines.empty())
+            out[filename] = std::move(lines);
+    return out;
+}
+
+template files_t read_llvm_coverage<files_t>(
+    const std::deque<std::string>&, const std::deque<std::string>&,
+    filename_selector_t);
+template counted_files_t read_llvm_coverage<counted_files_t>(
+    const std::deque<std::string>&, const std::deque<std::string>&,
+    filename_selector_t);
@@ -0,0 +1,22 @@
+#pragma once
+#include <deque>
+#include "gcov_json_handler.hpp"
+
+// Same lines as llvm-profdata merge followed by llvm-cov export of every
+// executable, read straight from the __llvm_covmap and __llvm_covfun
+// sections (coverage mapping version 4 and later) of 64-bit little-endian
+// ELF executables and from .profraw or .profdata files. Executables without
+// these sections are skipped and a function linked into several of them is
+// counted once. The counts of a line are summed across functions, like
+// llvm-cov does for the instantiations of a template or generic.
+template<typename files_T>
+files_T read_llvm_coverage(const std::deque<std::string>& executables,
+                           const std::deque<std::string>& profiles,
+                           filename_selector_t filename_selector);
+
+extern template files_t read_llvm_coverage<files_t>(
+    const std::deque<std::string>&, const std::deque<std::string>&,
+    filename_selector_t);
+extern template counted_files_t read_llvm_coverage<counted_files_t>(
+    const std::deque<std::string>&, const std::deque<std::string>&,
+    filename_selector_t);
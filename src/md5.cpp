@@ -0,0 +1,102 @@
+#include "md5.hpp"
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr std::array<std::uint32_t, 64> k{
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+constexpr std::array<unsigned, 64> shift{
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+std::uint32_t rotate_left(std::uint32_t x, unsigned c)
+{
+    return (x << c) | (x >> (32 - c));
+}
+
+void process_block(std::array<std::uint32_t, 4>& state,
+                   const unsigned char* block)
+{
+    std::uint32_t m[16];
+    for (unsigned i = 0; i < 16; ++i)
+        m[i] = block[i * 4] | block[i * 4 + 1] << 8 |
+            block[i * 4 + 2] << 16 |
+            static_cast<std::uint32_t>(block[i * 4 + 3]) << 24;
+    auto [a, b, c, d] = state;
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        std::uint32_t f;
+        unsigned g;
+        if (i < 16)
+        {
+            f = (b & c) | (~b & d);
+            g = i;
+        }
+        else if (i < 32)
+        {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        }
+        else if (i < 48)
+        {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        }
+        else
+        {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        f += a + k[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b += rotate_left(f, shift[i]);
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+}
+
+std::uint64_t md5_hash(std::string_view data)
+{
+    std::array<std::uint32_t, 4> state{
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    auto size = data.size();
+    for (; size >= 64; bytes += 64, size -= 64)
+        process_block(state, bytes);
+
+    // padding: 0x80, zeros, then the length in bits
+    unsigned char tail[128] = {};
+    std::memcpy(tail, bytes, size);
+    tail[size] = 0x80;
+    const auto tail_size = size < 56 ? 64 : 128;
+    const std::uint64_t bits = static_cast<std::uint64_t>(data.size()) * 8;
+    for (unsigned i = 0; i < 8; ++i)
+        tail[tail_size - 8 + i] = bits >> (8 * i);
+    process_block(state, tail);
+    if (tail_size == 128)
+        process_block(state, tail + 64);
+
+    return state[0] | static_cast<std::uint64_t>(state[1]) << 32;
+}
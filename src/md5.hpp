@@ -0,0 +1,7 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// Lower 64 bits of the MD5 digest read as little-endian, the way LLVM hashes
+// function names (NameRef) and coverage filename blobs (FilenamesRef).
+std::uint64_t md5_hash(std::string_view data);
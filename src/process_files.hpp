@@ -0,0 +1,283 @@
+#pragma once
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/process.hpp>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "concurrency.hpp"
+#include "files_merge.hpp"
+#include "gcov_json_handler.hpp"
+#include "uring_reactor.hpp"
+
+// Reads pipe until EOF straight into buf. The read size grows with the
+// output up to 1 MiB, so with an enlarged pipe (see spawn_launcher_t) a
+// multi-MB report takes a few wakeups instead of one per 64 KiB as with
+// asio::dynamic_buffer.
+inline void async_read_all(boost::process::async_pipe& pipe, std::string& buf)
+{
+    const auto size = buf.size();
+    const auto chunk = std::clamp<std::size_t>(size, 1 << 16, 1 << 20);
+    buf.resize(size + chunk);
+    pipe.async_read_some(
+        boost::asio::buffer(&buf[size], chunk),
+        [&pipe, &buf, size] (const boost::system::error_code& ec,
+                             std::size_t n) {
+            buf.resize(size + n);
+            if (!ec)
+                async_read_all(pipe, buf);
+        });
+}
+
+// Waits for child with wait4, accounting its resource usage in adaptive
+// when given, and returns its exit code (128 + the signal when killed).
+// The child is detached, boost::process has nothing left to reap.
+inline int wait_child(boost::process::child& child, adaptive_limit_t* adaptive)
+{
+    int status = 0;
+    rusage usage{};
+    const auto pid = child.id();
+    while (::wait4(pid, &status, 0, &usage) < 0)
+        if (errno != EINTR)
+            throw std::system_error{errno, std::generic_category(), "wait4"};
+    child.detach();
+    if (adaptive)
+        adaptive->reaped(usage);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// Runs start_process on every file, at most j children at once, and parses
+// their stdout with parse_json. Both are policies known at compile time:
+// start_process(file, stderr_pipe, stdout_pipe, io_context) returns a
+// std::unique_ptr<boost::process::child>, e.g. gcov_launcher_t or a
+// start_process_t, parse_json(files_T&, const std::string&) is typically
+// parse_gcov_json or parse_llvm_json with a selector from selectors.hpp.
+// files_T is either files_t or counted_files_t and isn't deduced.
+// j is the number of children running at once, 0 picks it adaptively
+// (see adaptive_limit_t).
+// parse_json is called concurrently from several threads, each thread
+// with its own files_T, the results are merged with reduce_files.
+// Jobs are taken from the back of files, see rank_by_similarity.
+// An exception thrown by start_process ends the run once the children
+// already started exited, e.g. to cancel it between jobs.
+// early_answer(const files_T&), when given, is called from a parser thread
+// with the result of the job at the back alone. That job then runs on its
+// own before the others, so the answer is ready after a single child.
+// The pipes are drained by uring_reactor_t when it's enabled, by the
+// io_context otherwise.
+struct no_early_answer_t
+{
+    template<typename files_T>
+    void operator()(const files_T&) const {}
+};
+
+template<typename files_T = files_t, typename launcher_T, typename parser_T,
+         typename early_T = no_early_answer_t>
+files_T process_files(
+    launcher_T start_process,
+    parser_T parse_json,
+    std::deque<std::string> files,
+    unsigned j,
+    early_T early_answer = {}
+)
+{
+    constexpr bool early = !std::is_same_v<early_T, no_early_answer_t>;
+    struct per_proc_t
+    {
+        // pipes are created in place, moving an async_pipe is broken in
+        // some boost versions
+        explicit per_proc_t(boost::asio::io_context& ctx)
+            : std_out_pipe{ctx}, std_err_pipe{ctx} {}
+        boost::process::async_pipe std_out_pipe;
+        std::string std_out;
+        std::unique_ptr<boost::process::child> child;
+        boost::process::async_pipe std_err_pipe;
+        std::string std_err;
+        std::string gcno;
+        bool first = false;
+    };
+    std::deque<per_proc_t> per_proc;
+    boost::asio::io_context ctx;
+    std::optional<uring_reactor_t> uring;
+    if (uring_reactor_t::enabled())
+    {
+        try
+        {
+            uring.emplace();
+        }
+        catch (const std::system_error&)
+        {
+            // e.g. out of locked memory for the rings, asio still works
+        }
+    }
+    std::size_t pushed = 0;
+    auto push = [&] {
+        auto& pp = per_proc.emplace_back(ctx);
+        pp.first = pushed++ == 0;
+        try
+        {
+            pp.child = start_process(files.back(), pp.std_err_pipe,
+                                     pp.std_out_pipe, ctx);
+        }
+        catch (...)
+        {
+            per_proc.pop_back();
+            throw;
+        }
+        pp.gcno = std::move(files.back());
+        if (!uring)
+        {
+            async_read_all(pp.std_out_pipe, pp.std_out);
+            async_read_all(pp.std_err_pipe, pp.std_err);
+        }
+        files.pop_back();
+    };
+    auto drain = [&] {
+        if (!uring)
+        {
+            ctx.run();
+            return;
+        }
+        std::vector<uring_reactor_t::pipe_t> pipes;
+        for (auto& pp : per_proc)
+        {
+            pipes.push_back({pp.std_out_pipe.native_source(), &pp.std_out});
+            pipes.push_back({pp.std_err_pipe.native_source(), &pp.std_err});
+        }
+        uring->read_all(pipes);
+    };
+    // Output is parsed on a thread pool, every parser thread fills its own
+    // partial result and the partials are reduced once all jobs finished.
+    // Reducing costs more than merging a few reports serially, a parser
+    // thread is only added per min_jobs_per_parser jobs, so a short sweep
+    // or a single CPU fills one partial that is returned as is.
+    // At most max_queued outputs wait for a parser, when gcov outpaces them
+    // the next batch is held back instead of piling up reports in memory.
+    constexpr std::size_t min_jobs_per_parser = 64;
+    const auto parse_threads = static_cast<unsigned>(std::clamp<std::size_t>(
+        files.size() / min_jobs_per_parser, 1, available_cpus()));
+    const auto max_queued = 2 * parse_threads;
+    std::size_t queued = 0;
+    std::condition_variable parsed;
+    std::vector<files_T> partials(parse_threads);
+    std::vector<unsigned> free_partials(parse_threads);
+    std::iota(free_partials.begin(), free_partials.end(), 0u);
+    std::exception_ptr parse_error;
+    std::mutex mutex;
+    auto parse = [&] (const std::string& buf, bool first) {
+        unsigned partial;
+        {
+            std::lock_guard lock{mutex};
+            partial = free_partials.back();
+            free_partials.pop_back();
+        }
+        try
+        {
+            if constexpr (early)
+            {
+                if (first)
+                {
+                    files_T answer;
+                    parse_json(answer, buf);
+                    early_answer(std::as_const(answer));
+                    merge_files(partials[partial], std::move(answer));
+                }
+                else
+                    parse_json(partials[partial], buf);
+            }
+            else
+                parse_json(partials[partial], buf);
+        }
+        catch (const parse_exception& ex)
+        {
+            std::lock_guard lock{mutex};
+            std::cerr << "error in gcov json file: " << ex.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::lock_guard lock{mutex};
+            if (!parse_error)
+                parse_error = std::current_exception();
+        }
+        std::lock_guard lock{mutex};
+        free_partials.push_back(partial);
+        --queued;
+        parsed.notify_one();
+    };
+    // declared after everything the parse tasks use, when a launch or a
+    // read throws the pool is destroyed first, joining the running tasks
+    boost::asio::thread_pool parsers{parse_threads};
+
+    std::optional<adaptive_limit_t> adaptive;
+    if (!j)
+        adaptive.emplace();
+
+    auto pop = [&] {
+        auto it = per_proc.begin();
+        auto& [_, buf, child, __, err, gcno, first] = *it;
+        // reaped here for the resource usage of this child alone
+        const auto exit_code = wait_child(*child, adaptive ? &*adaptive :
+                                                             nullptr);
+        if (exit_code != 0)
+        {
+            std::cerr << "-----------------------------------------------\n" <<
+                "error in gcov process: " << exit_code << "\n" <<
+                err << std::endl;
+            per_proc.erase(it);
+            return;
+        }
+        {
+            std::unique_lock lock{mutex};
+            parsed.wait(lock, [&] { return queued < max_queued; });
+            ++queued;
+        }
+        boost::asio::post(parsers,
+                          [&parse, buf=std::move(buf), first=first] {
+                              parse(buf, first);
+                          });
+        per_proc.erase(it);
+    };
+
+    while (!files.empty())
+    {
+        ctx.restart();
+        if (adaptive)
+            adaptive->start_batch();
+        const auto limit = early && pushed == 0 ? 1u :
+                           adaptive ? adaptive->limit() : j;
+        try
+        {
+            while (per_proc.size() < limit && !files.empty())
+                push();
+        }
+        catch (...)
+        {
+            // the jobs already running are reaped before giving up
+            drain();
+            while (!per_proc.empty())
+                pop();
+            throw;
+        }
+        const auto in_flight = per_proc.size();
+        drain();
+        while (!per_proc.empty())
+            pop();
+        if (adaptive)
+            adaptive->end_batch(in_flight);
+    }
+    parsers.join();
+    if (parse_error)
+        std::rethrow_exception(parse_error);
+    return reduce_files(std::move(partials), parse_threads);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "gcov_json_handler.hpp"
+
+// Filename selector policies for the templated parsers in
+// gcov_json_parser.hpp. They are called for every file entry and llvm
+// function, with a view of the JSON string, so no std::string is built per
+// record and the comparison is inlined into the parser loop.
+
+struct any_path_t
+{
+    bool operator()(std::string_view) const { return true; }
+};
+
+class path_selector_t
+{
+public:
+    explicit path_selector_t(std::string path) : path_{std::move(path)} {}
+    bool operator()(std::string_view filename) const
+    {
+        return filename == path_;
+    }
+
+private:
+    std::string path_;
+};
+
+class prefix_selector_t
+{
+public:
+    explicit prefix_selector_t(std::string prefix) : prefix_{std::move(prefix)}
+    {}
+    bool operator()(std::string_view filename) const
+    {
+        return filename.substr(0, prefix_.size()) == prefix_;
+    }
+
+private:
+    std::string prefix_;
+};
+
+// Several paths, looked up by a hash computed once per path up front.
+class path_set_selector_t
+{
+public:
+    explicit path_set_selector_t(const std::vector<std::string>& paths)
+    {
+        paths_.reserve(paths.size());
+        for (const auto& path : paths)
+            paths_.emplace_back(std::hash<std::string_view>{}(path), path);
+        std::sort(paths_.begin(), paths_.end());
+        paths_.erase(std::unique(paths_.begin(), paths_.end()), paths_.end());
+    }
+    bool operator()(std::string_view filename) const
+    {
+        const auto hash = std::hash<std::string_view>{}(filename);
+        auto it = std::lower_bound(
+            paths_.begin(), paths_.end(), hash,
+            [] (const auto& path, std::size_t hash) {
+                return path.first < hash;
+            });
+        for (; it != paths_.end() && it->first == hash; ++it)
+            if (it->second == filename)
+                return true;
+        return false;
+    }
+
+private:
+    std::vector<std::pair<std::size_t, std::string>> paths_;
+};
+
+// Adapts a type erased filename_selector_t, an empty one selects everything.
+class erased_selector_t
+{
+public:
+    explicit erased_selector_t(const filename_selector_t& selector)
+        : selector_{selector} {}
+    bool operator()(std::string_view filename) const
+    {
+        return !selector_ || selector_(std::string{filename});
+    }
+
+private:
+    const filename_selector_t& selector_;
+};
@@ -0,0 +1,114 @@
+#include "spawn_launcher.hpp"
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <cerrno>
+#include <system_error>
+
+extern char** environ;
+
+namespace {
+
+// async_pipe creates its ends with plain pipe(), another thread spawning
+// before FD_CLOEXEC could be set on them would inherit them. The ends are
+// replaced with ones created close-on-exec, what leaked from the old pair
+// keeps an unread pipe open and nothing else.
+void reopen_cloexec(boost::process::async_pipe& pipe)
+{
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) == -1)
+        throw std::system_error{errno, std::generic_category(), "pipe2"};
+    boost::system::error_code ec;
+    auto&& source = std::move(pipe).source();
+    auto&& sink = std::move(pipe).sink();
+    source.close(ec);
+    sink.close(ec);
+    source.assign(fds[0], ec);
+    if (ec)
+        ::close(fds[0]);
+    boost::system::error_code sink_ec;
+    sink.assign(fds[1], sink_ec);
+    if (sink_ec)
+        ::close(fds[1]);
+    if (ec || sink_ec)
+        throw boost::system::system_error{ec ? ec : sink_ec, "assign pipe"};
+}
+
+struct file_actions_t
+{
+    file_actions_t() { ::posix_spawn_file_actions_init(&actions); }
+    ~file_actions_t() { ::posix_spawn_file_actions_destroy(&actions); }
+    posix_spawn_file_actions_t actions;
+};
+
+struct spawn_attributes_t
+{
+    spawn_attributes_t() { ::posix_spawnattr_init(&attributes); }
+    ~spawn_attributes_t() { ::posix_spawnattr_destroy(&attributes); }
+    posix_spawnattr_t attributes;
+};
+
+}
+
+spawn_launcher_t::spawn_launcher_t(const std::string& tool,
+                                   std::vector<std::string> args)
+    : tool_{tool}, args_{std::move(args)}
+{
+    if (tool.find('/') != std::string::npos)
+        path_ = tool;
+    else
+        path_ = boost::process::search_path(tool).string();
+}
+
+std::unique_ptr<boost::process::child> spawn_launcher_t::operator()(
+    const std::string& file,
+    boost::process::async_pipe& ap_err,
+    boost::process::async_pipe& ap_out,
+    boost::asio::io_context&) const
+{
+    // reported on the first job, a sweep with nothing to do doesn't need it
+    if (path_.empty())
+        throw std::system_error{ENOENT, std::generic_category(),
+                                tool_ + " not found in PATH"};
+
+    // other jobs' children must not inherit these pipes, a leaked write end
+    // would hold back the EOF of this job until they exit
+    reopen_cloexec(ap_out);
+    reopen_cloexec(ap_err);
+#ifdef F_SETPIPE_SZ
+    // best effort, capped by /proc/sys/fs/pipe-max-size for unprivileged
+    // users
+    ::fcntl(ap_out.native_sink(), F_SETPIPE_SZ, pipe_size);
+#endif
+
+    file_actions_t file_actions;
+    ::posix_spawn_file_actions_adddup2(&file_actions.actions,
+                                       ap_out.native_sink(), STDOUT_FILENO);
+    ::posix_spawn_file_actions_adddup2(&file_actions.actions,
+                                       ap_err.native_sink(), STDERR_FILENO);
+    spawn_attributes_t attributes;
+#ifdef POSIX_SPAWN_USEVFORK
+    ::posix_spawnattr_setflags(&attributes.attributes, POSIX_SPAWN_USEVFORK);
+#endif
+
+    std::vector<char*> argv;
+    argv.reserve(args_.size() + 3);
+    argv.push_back(const_cast<char*>(path_.c_str()));
+    for (const auto& arg : args_)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(const_cast<char*>(file.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    if (const auto rc = ::posix_spawn(&pid, path_.c_str(),
+                                      &file_actions.actions,
+                                      &attributes.attributes, argv.data(),
+                                      environ))
+        throw std::system_error{rc, std::generic_category(),
+                                "posix_spawn " + path_};
+    // only the child writes, the read ends see EOF once it exits
+    boost::system::error_code ec;
+    std::move(ap_out).sink().close(ec);
+    std::move(ap_err).sink().close(ec);
+    return std::make_unique<boost::process::child>(pid);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <boost/process.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// start_process for process_files running tool with args followed by the
+// file. The tool is looked up in PATH once, when the launcher is created,
+// and started with posix_spawn, which glibc implements with vfork
+// semantics, so a large parent process (e.g. Vim) doesn't pay for copying
+// its page tables on every job. The stdout pipe is enlarged to pipe_size
+// where the kernel allows it, so multi-MB reports need fewer wakeups.
+class spawn_launcher_t
+{
+public:
+    static constexpr int pipe_size = 1 << 20;
+
+    spawn_launcher_t(const std::string& tool, std::vector<std::string> args);
+
+    std::unique_ptr<boost::process::child> operator()(
+        const std::string& file,
+        boost::process::async_pipe& ap_err,
+        boost::process::async_pipe& ap_out,
+        boost::asio::io_context& ctx) const;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string tool_;
+    std::string path_;
+    std::vector<std::string> args_;
+};
@@ -0,0 +1,313 @@
+#include "tracefile_parser.hpp"
+#include "line_merge.hpp"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <vector>
+
+#ifdef spdlog_FOUND
+#include <spdlog/spdlog.h>
+#define TRACE(...) SPDLOG_TRACE(__VA_ARGS__)
+#else
+#define TRACE(...) (void)0
+#endif
+
+namespace {
+
+template<typename T>
+bool parse_number(const char* first, const char* last, T& value)
+{
+    const auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc{} && ptr == last;
+}
+
+template<typename files_T>
+void parse_lcov_impl(files_T& out,
+                     std::istream& in,
+                     const filename_selector_t& filename_selector)
+{
+    typename files_T::mapped_type* lines_out = nullptr;
+    typename files_T::mapped_type pending;
+    bool skipping = false;
+    const auto flush = [&] {
+        if (lines_out)
+            merge_lines(*lines_out, pending, sum_counts{});
+        pending.clear();
+        lines_out = nullptr;
+        skipping = false;
+    };
+
+    std::string line;
+    for (unsigned lineno = 1; std::getline(in, line); ++lineno)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.rfind("SF:", 0) == 0)
+        {
+            flush();
+            auto filename = line.substr(3);
+            if (filename_selector && !filename_selector(filename))
+            {
+                TRACE("Skipping file: {}", filename);
+                skipping = true;
+                continue;
+            }
+            lines_out = &out[std::move(filename)];
+        }
+        else if (line.rfind("DA:", 0) == 0)
+        {
+            if (skipping)
+                continue;
+            if (!lines_out)
+                throw parse_exception{"DA record outside of a SF record "
+                                      "(line " + std::to_string(lineno) + ")"};
+            // DA:<line number>,<execution count>[,<checksum>]
+            const auto* first = line.data() + 3;
+            const auto* last = line.data() + line.size();
+            const auto* comma = std::find(first, last, ',');
+            const auto* end = std::find(comma == last ? last : comma + 1,
+                                        last, ',');
+            unsigned line_number;
+            std::uint64_t count;
+            if (comma == last ||
+                !parse_number(first, comma, line_number) ||
+                !parse_number(comma + 1, end, count))
+                throw parse_exception{"Invalid DA record (line " +
+                                      std::to_string(lineno) + ")"};
+            add_line(pending, line_number, count, !count);
+        }
+        else if (line == "end_of_record")
+            flush();
+    }
+    flush();
+}
+
+std::string decode_entities(const std::string& value)
+{
+    static const std::pair<const char*, char> entities[]{
+        {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'},
+        {"&apos;", '\''},
+    };
+    std::string rv;
+    rv.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); ++i)
+    {
+        if (value[i] == '&')
+        {
+            bool decoded = false;
+            for (const auto& [entity, c] : entities)
+                if (value.compare(i, std::strlen(entity), entity) == 0)
+                {
+                    rv += c;
+                    i += std::strlen(entity) - 1;
+                    decoded = true;
+                    break;
+                }
+            if (decoded)
+                continue;
+        }
+        rv += value[i];
+    }
+    return rv;
+}
+
+// Reads the text before the next tag and the tag itself without the angle
+// brackets. Keeps reading when '>' is inside a quoted attribute or comment.
+bool next_tag(std::istream& in, std::string& text, std::string& tag)
+{
+    std::getline(in, text, '<');
+    if (!std::getline(in, tag, '>'))
+        return false;
+    const auto unterminated = [&tag] {
+        if (tag.rfind("!--", 0) == 0)
+            return tag.size() < 5 || tag.compare(tag.size() - 2, 2, "--") != 0;
+        return std::count(tag.begin(), tag.end(), '"') % 2 ||
+            std::count(tag.begin(), tag.end(), '\'') % 2;
+    };
+    std::string rest;
+    while (unterminated())
+    {
+        if (!std::getline(in, rest, '>'))
+            throw parse_exception{"Unterminated xml tag"};
+        tag += '>';
+        tag += rest;
+    }
+    return true;
+}
+
+std::string tag_name(const std::string& tag)
+{
+    return tag.substr(0, tag.find_first_of(" \t\r\n/", 1));
+}
+
+bool attribute(const std::string& tag, const char* name, std::string& value)
+{
+    const std::string key = name;
+    for (auto pos = tag.find(key); pos != std::string::npos;
+         pos = tag.find(key, pos + 1))
+    {
+        if (pos == 0 || !std::isspace(static_cast<unsigned char>(tag[pos - 1])))
+            continue;
+        auto eq = tag.find_first_not_of(" \t\r\n", pos + key.size());
+        if (eq == std::string::npos || tag[eq] != '=')
+            continue;
+        const auto quote = tag.find_first_not_of(" \t\r\n", eq + 1);
+        if (quote == std::string::npos ||
+            (tag[quote] != '"' && tag[quote] != '\''))
+            continue;
+        const auto end = tag.find(tag[quote], quote + 1);
+        if (end == std::string::npos)
+            return false;
+        value = decode_entities(tag.substr(quote + 1, end - quote - 1));
+        return true;
+    }
+    return false;
+}
+
+std::string resolve(const std::vector<std::string>& sources,
+                    const std::string& filename)
+{
+    namespace fs = boost::filesystem;
+    if (sources.empty() || fs::path{filename}.is_absolute())
+        return filename;
+    for (const auto& source : sources)
+    {
+        const auto path = (fs::path{source} / filename).lexically_normal();
+        if (fs::exists(path))
+            return path.string();
+    }
+    return (fs::path{sources.front()} / filename).lexically_normal().string();
+}
+
+template<typename files_T>
+void parse_cobertura_impl(files_T& out,
+                          std::istream& in,
+                          const filename_selector_t& filename_selector)
+{
+    std::vector<std::string> sources;
+    typename files_T::mapped_type* lines_out = nullptr;
+    typename files_T::mapped_type pending;
+    bool in_source = false;
+
+    std::string text;
+    std::string tag;
+    std::string value;
+    while (next_tag(in, text, tag))
+    {
+        if (in_source)
+        {
+            const auto first = text.find_first_not_of(" \t\r\n");
+            const auto last = text.find_last_not_of(" \t\r\n");
+            if (first != std::string::npos)
+                sources.push_back(
+                    decode_entities(text.substr(first, last - first + 1)));
+            in_source = false;
+        }
+        const auto name = tag_name(tag);
+        if (name == "source")
+            in_source = tag.back() != '/';
+        else if (name == "class")
+        {
+            if (!attribute(tag, "filename", value))
+                throw parse_exception{"Class without 'filename' attribute"};
+            auto filename = resolve(sources, value);
+            if (filename_selector && !filename_selector(filename))
+            {
+                TRACE("Skipping file: {}", filename);
+                lines_out = nullptr;
+                continue;
+            }
+            lines_out = &out[std::move(filename)];
+            pending.clear();
+            // <class .../> without lines is opened and closed at once
+            if (tag.back() == '/')
+                lines_out = nullptr;
+        }
+        else if (name == "/class")
+        {
+            // method lines repeat the class lines, take them only once
+            if (lines_out)
+                merge_lines(*lines_out, pending, max_counts{});
+            lines_out = nullptr;
+        }
+        else if (name == "line" && lines_out)
+        {
+            unsigned line_number;
+            std::uint64_t hits;
+            if (!attribute(tag, "number", value) ||
+                !parse_number(value.data(), value.data() + value.size(),
+                              line_number))
+                throw parse_exception{"Line without 'number' attribute"};
+            if (!attribute(tag, "hits", value) ||
+                !parse_number(value.data(), value.data() + value.size(),
+                              hits))
+                throw parse_exception{"Line without 'hits' attribute"};
+            add_line(pending, line_number, hits, !hits);
+        }
+    }
+    if (lines_out)
+        throw parse_exception{"Unterminated class element"};
+}
+
+template<typename files_T>
+void parse_tracefile_impl(files_T& out,
+                          const std::string& path,
+                          const filename_selector_t& filename_selector)
+{
+    std::ifstream in{path};
+    if (!in)
+        throw parse_exception{"Cannot open tracefile " + path};
+    in >> std::ws;
+    if (in.peek() == '<')
+        parse_cobertura_impl(out, in, filename_selector);
+    else
+        parse_lcov_impl(out, in, filename_selector);
+}
+
+}
+
+void parse_lcov(files_t& out,
+                std::istream& in,
+                filename_selector_t filename_selector)
+{
+    parse_lcov_impl(out, in, filename_selector);
+}
+
+void parse_lcov(counted_files_t& out,
+                std::istream& in,
+                filename_selector_t filename_selector)
+{
+    parse_lcov_impl(out, in, filename_selector);
+}
+
+void parse_cobertura(files_t& out,
+                     std::istream& in,
+                     filename_selector_t filename_selector)
+{
+    parse_cobertura_impl(out, in, filename_selector);
+}
+
+void parse_cobertura(counted_files_t& out,
+                     std::istream& in,
+                     filename_selector_t filename_selector)
+{
+    parse_cobertura_impl(out, in, filename_selector);
+}
+
+void parse_tracefile(files_t& out,
+                     const std::string& path,
+                     filename_selector_t filename_selector)
+{
+    parse_tracefile_impl(out, path, filename_selector);
+}
+
+void parse_tracefile(counted_files_t& out,
+                     const std::string& path,
+                     filename_selector_t filename_selector)
+{
+    parse_tracefile_impl(out, path, filename_selector);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <iosfwd>
+#include "gcov_json_handler.hpp"
+
+// lcov/fastcov tracefile, only SF: and DA: records are used. Records of the
+// same source from several tests are summed.
+void parse_lcov(files_t& out,
+                std::istream& in,
+                filename_selector_t filename_selector);
+void parse_lcov(counted_files_t& out,
+                std::istream& in,
+                filename_selector_t filename_selector);
+
+// Cobertura xml as written by gcovr or coverage.py. Relative class
+// filenames are resolved against the first <source> that contains them.
+void parse_cobertura(files_t& out,
+                     std::istream& in,
+                     filename_selector_t filename_selector);
+void parse_cobertura(counted_files_t& out,
+                     std::istream& in,
+                     filename_selector_t filename_selector);
+
+// Opens path and picks the parser from its content.
+void parse_tracefile(files_t& out,
+                     const std::string& path,
+                     filename_selector_t filename_selector);
+void parse_tracefile(counted_files_t& out,
+                     const std::string& path,
+                     filename_selector_t filename_selector);
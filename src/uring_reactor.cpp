@@ -0,0 +1,308 @@
+#include "uring_reactor.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace {
+
+template<typename T>
+T load_acquire(const T* p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+void store_release(T* p, T value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+std::system_error last_error(const char* what)
+{
+    return {errno, std::generic_category(), what};
+}
+
+}
+
+struct uring_reactor_t::ring_t
+{
+    explicit ring_t(unsigned entries)
+    {
+        io_uring_params params{};
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries,
+                                        &params));
+        if (fd < 0)
+            throw last_error("io_uring_setup");
+        try
+        {
+            map_rings(params);
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    ~ring_t() { release(); }
+
+    void map_rings(const io_uring_params& params)
+    {
+        // the completion queue must never overflow, at most sq_entries
+        // reads are in flight and cq_entries is twice as large
+        sq_entries = params.sq_entries;
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes +
+            params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap)
+            sq_size = cq_size = std::max(sq_size, cq_size);
+        sq_ring = map(sq_size, IORING_OFF_SQ_RING);
+        cq_ring = single_mmap ? sq_ring : map(cq_size, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(map(sqes_size, IORING_OFF_SQES));
+
+        auto* sq = static_cast<char*>(sq_ring);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto* cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    void release()
+    {
+        if (sqes)
+            ::munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring)
+            ::munmap(cq_ring, cq_size);
+        if (sq_ring)
+            ::munmap(sq_ring, sq_size);
+        ::close(fd);
+    }
+
+    void* map(std::size_t size, off_t offset)
+    {
+        auto* rv = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, offset);
+        if (rv == MAP_FAILED)
+            throw last_error("mmap io_uring");
+        return rv;
+    }
+
+    io_uring_sqe& next_sqe()
+    {
+        const auto tail = *sq_tail;
+        const auto index = tail & sq_mask;
+        sq_array[index] = index;
+        auto& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        store_release(sq_tail, tail + 1);
+        return sqe;
+    }
+
+    unsigned unsubmitted() const
+    {
+        return *sq_tail - load_acquire(sq_head);
+    }
+
+    void drop_unsubmitted()
+    {
+        store_release(sq_tail, load_acquire(sq_head));
+    }
+
+    // IORING_OP_READ came with Linux 5.6, as did the probe, on 5.1 to 5.5
+    // the ring is created but every read would fail with EINVAL
+    bool supports_read() const
+    {
+        constexpr unsigned ops = 256;
+        std::vector<char> buf(sizeof(io_uring_probe) +
+                              ops * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(buf.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+                      probe, ops) < 0)
+            return false;
+        return IORING_OP_READ <= probe->last_op &&
+            IORING_OP_READ < probe->ops_len &&
+            probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED;
+    }
+
+    int fd = -1;
+    unsigned sq_entries = 0;
+    void* sq_ring = nullptr;
+    std::size_t sq_size = 0;
+    void* cq_ring = nullptr;
+    std::size_t cq_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqes_size = 0;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+};
+
+uring_reactor_t::uring_reactor_t(unsigned entries)
+    : ring_{std::make_unique<ring_t>(entries)}
+{
+    if (!ring_->supports_read())
+        throw std::system_error{EOPNOTSUPP, std::generic_category(),
+                                "io_uring without IORING_OP_READ"};
+}
+
+uring_reactor_t::~uring_reactor_t() = default;
+
+void uring_reactor_t::read_all(const std::vector<pipe_t>& pipes)
+{
+    struct state_t
+    {
+        int fd;
+        std::string* out;
+        std::size_t size;
+    };
+    std::vector<state_t> states;
+    states.reserve(pipes.size());
+    std::deque<std::size_t> ready;
+    for (const auto& [fd, out] : pipes)
+    {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        ready.push_back(states.size());
+        states.push_back({fd, out, out->size()});
+    }
+
+    // every pipe keeps its read in flight, with a slot shared by turns a
+    // child blocked writing one pipe could hold back the reads its pipes
+    // need and deadlock
+    if (states.size() > ring_->sq_entries)
+        ring_ = std::make_unique<ring_t>(
+            static_cast<unsigned>(states.size()));
+    auto& ring = *ring_;
+    std::size_t remaining = states.size();
+    unsigned in_flight = 0;
+    int error = 0;
+    while (remaining && (!error || in_flight))
+    {
+        while (!error && !ready.empty())
+        {
+            auto& state = states[ready.front()];
+            const auto chunk = std::clamp<std::size_t>(state.size, 1 << 16,
+                                                       1 << 20);
+            state.out->resize(state.size + chunk);
+            auto& sqe = ring.next_sqe();
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = state.fd;
+            sqe.addr = reinterpret_cast<std::uintptr_t>(
+                &(*state.out)[state.size]);
+            sqe.len = static_cast<unsigned>(chunk);
+            sqe.off = static_cast<std::uint64_t>(-1);
+            sqe.user_data = ready.front();
+            ready.pop_front();
+            ++in_flight;
+        }
+
+        ++stats_.enters;
+        if (::syscall(__NR_io_uring_enter, ring.fd, ring.unsubmitted(), 1,
+                      IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+            errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            // the reads the kernel didn't take are dropped, the ones it
+            // took still write into the strings and are waited for
+            const auto errno_value = errno;
+            in_flight -= ring.unsubmitted();
+            ring.drop_unsubmitted();
+            if (!in_flight)
+                throw std::system_error{errno_value, std::generic_category(),
+                                        "io_uring_enter"};
+            error = errno_value;
+        }
+
+        auto head = *ring.cq_head;
+        const auto tail = load_acquire(ring.cq_tail);
+        for (; head != tail; ++head)
+        {
+            const auto& cqe = ring.cqes[head & ring.cq_mask];
+            auto& state = states[cqe.user_data];
+            --in_flight;
+            if (cqe.res > 0)
+            {
+                ++stats_.reads;
+                state.size += cqe.res;
+                state.out->resize(state.size);
+                ready.push_back(cqe.user_data);
+            }
+            else if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+            {
+                state.out->resize(state.size);
+                ready.push_back(cqe.user_data);
+            }
+            else
+            {
+                state.out->resize(state.size);
+                --remaining;
+                if (cqe.res < 0 && !error)
+                    error = -cqe.res;
+            }
+        }
+        store_release(ring.cq_head, head);
+    }
+    if (error)
+        throw std::system_error{error, std::generic_category(),
+                                "io_uring read"};
+}
+
+#else
+
+struct uring_reactor_t::ring_t {};
+
+uring_reactor_t::uring_reactor_t(unsigned)
+{
+    throw std::system_error{ENOSYS, std::generic_category(),
+                            "built without io_uring"};
+}
+
+uring_reactor_t::~uring_reactor_t() = default;
+
+void uring_reactor_t::read_all(const std::vector<pipe_t>&)
+{
+}
+
+#endif
+
+bool uring_reactor_t::enabled()
+{
+    const auto* env = std::getenv("VIMGCOV_IO_URING");
+    if (!env || !*env || std::string{env} == "0")
+        return false;
+    static const bool available = [] {
+        try
+        {
+            uring_reactor_t probe{1};
+            return true;
+        }
+        catch (const std::system_error&)
+        {
+            return false;
+        }
+    }();
+    return available;
+}
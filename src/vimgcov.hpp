@@ -1,15 +1,69 @@
+#pragma once
 #include <boost/process.hpp>
 #include <functional>
 #include "gcov_json_handler.hpp"
+#include "process_files.hpp"
+#include "spawn_launcher.hpp"
 
-files_t process_files(
-    std::function<std::unique_ptr<boost::process::child>(
-        const std::string&,
-        boost::process::async_pipe&,
-        boost::process::async_pipe&,
-        boost::asio::io_context&
-    )> start_process,
-    std::function<void(files_t&, const std::string&)> parse_json,
-    std::deque<std::string> files,
-    unsigned j
-);
+// Type erased launcher, for picking gcov or llvm-cov at runtime.
+using start_process_t = std::function<std::unique_ptr<boost::process::child>(
+    const std::string&,
+    boost::process::async_pipe&,
+    boost::process::async_pipe&,
+    boost::asio::io_context&
+)>;
+
+// The tools the launchers run when none is given: $VIMGCOV_GCOV and
+// $VIMGCOV_LLVM_COV when set (e.g. to a versioned gcov or the stand-in of
+// the scale tests), else gcov and llvm-cov from PATH.
+std::string gcov_tool();
+std::string llvm_cov_tool();
+
+// start_process for process_files running gcov on a gcno file, an empty
+// tool picks gcov_tool()
+struct gcov_launcher_t : spawn_launcher_t
+{
+    explicit gcov_launcher_t(const std::string& tool = {});
+};
+
+// start_process for process_files running llvm-cov export on an executable,
+// an empty tool picks llvm_cov_tool()
+struct llvm_cov_launcher_t : spawn_launcher_t
+{
+    explicit llvm_cov_launcher_t(const std::string& profdata,
+                                 const std::string& tool = {});
+};
+
+start_process_t gcov_launcher(const std::string& tool = {});
+start_process_t llvm_cov_launcher(std::string profdata,
+                                  const std::string& tool = {});
+
+// coverage of path from gcov run on every gcno
+template<typename files_T = files_t>
+files_T getcoverage(
+    std::deque<std::string> gcnos,
+    unsigned j,
+    const std::string& path,
+    const std::string& gcov = {});
+
+// coverage of path from llvm-cov export run on every executable
+template<typename files_T = files_t>
+files_T getllvmcoverage(
+    std::deque<std::string> executables,
+    unsigned j,
+    const std::string& path,
+    const std::string& profdata,
+    const std::string& llvm_cov = {});
+
+extern template files_t getcoverage<files_t>(
+    std::deque<std::string>, unsigned, const std::string&,
+    const std::string&);
+extern template counted_files_t getcoverage<counted_files_t>(
+    std::deque<std::string>, unsigned, const std::string&,
+    const std::string&);
+extern template files_t getllvmcoverage<files_t>(
+    std::deque<std::string>, unsigned, const std::string&,
+    const std::string&, const std::string&);
+extern template counted_files_t getllvmcoverage<counted_files_t>(
+    std::deque<std::string>, unsigned, const std::string&,
+    const std::string&, const std::string&);
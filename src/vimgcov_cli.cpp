@@ -0,0 +1,194 @@
+#include "vimgcov.hpp"
+#include "coverage_io.hpp"
+#include "gcov_json_parser.hpp"
+#include "llvm_coverage.hpp"
+#include "selectors.hpp"
+#include "tracefile_parser.hpp"
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr auto usage = R"(usage: vimgcov-cli [options] [directory]
+
+Runs gcov on every .gcno file under directory (default: .) and writes the
+merged line coverage of all sources.
+
+options:
+  --llvm PROFDATA      run llvm-cov export on the executables directly in
+                       directory instead
+  --native             read the coverage mapping of the executables and the
+                       PROFDATA (.profdata or .profraw) without llvm-cov
+  --tracefile FILE     read an lcov tracefile or Cobertura xml instead
+  -j N                 number of gcov/llvm-cov processes, 0 adapts (default)
+  -f, --format FORMAT  json (default), lcov or binary
+  -o, --output FILE    write to FILE instead of stdout
+  --source PREFIX      only keep sources whose path starts with PREFIX
+  --stats              print throughput to stderr
+  -h, --help           show this help
+)";
+
+struct options_t
+{
+    std::string directory = ".";
+    std::string profdata;
+    std::string tracefile;
+    bool native = false;
+    unsigned j = 0;
+    std::string format = "json";
+    std::string output;
+    std::string source;
+    bool stats = false;
+};
+
+options_t parse_args(int argc, char** argv)
+{
+    options_t options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&] {
+            if (++i == argc)
+                throw std::invalid_argument{"missing value for " + arg};
+            return std::string{argv[i]};
+        };
+        if (arg == "-h" || arg == "--help")
+        {
+            std::cout << usage;
+            std::exit(0);
+        }
+        else if (arg == "--llvm")
+            options.profdata = value();
+        else if (arg == "--native")
+            options.native = true;
+        else if (arg == "--tracefile")
+            options.tracefile = value();
+        else if (arg == "-j")
+            options.j = std::stoul(value());
+        else if (arg == "-f" || arg == "--format")
+            options.format = value();
+        else if (arg == "-o" || arg == "--output")
+            options.output = value();
+        else if (arg == "--source")
+            options.source = value();
+        else if (arg == "--stats")
+            options.stats = true;
+        else if (!arg.empty() && arg[0] == '-')
+            throw std::invalid_argument{"unknown option " + arg};
+        else
+            options.directory = arg;
+    }
+    if (options.format != "json" && options.format != "lcov" &&
+        options.format != "binary")
+        throw std::invalid_argument{"unknown format " + options.format};
+    return options;
+}
+
+std::deque<std::string> find_gcnos(const std::string& directory)
+{
+    std::deque<std::string> gcnos;
+    for (const auto& entry :
+         boost::filesystem::recursive_directory_iterator(directory))
+        if (entry.path().extension() == ".gcno" &&
+            boost::filesystem::is_regular_file(entry.status()))
+            gcnos.push_back(entry.path().string());
+    return gcnos;
+}
+
+std::deque<std::string> find_executables(const std::string& directory)
+{
+    std::deque<std::string> executables;
+    for (const auto& entry : boost::filesystem::directory_iterator(directory))
+        if (boost::filesystem::is_regular_file(entry.status()) &&
+            entry.status().permissions() & boost::filesystem::owner_exe)
+            executables.push_back(entry.path().string());
+    return executables;
+}
+
+void write(std::ostream& out, const options_t& options,
+           const counted_files_t& files)
+{
+    if (options.format == "lcov")
+        write_lcov(out, files);
+    else if (options.format == "binary")
+        write_binary(out, files);
+    else
+        write_json(out, files);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const auto options = parse_args(argc, argv);
+        const bool llvm = !options.profdata.empty();
+        const prefix_selector_t prefix{options.source};
+        const filename_selector_t selector = prefix;
+
+        const auto start = std::chrono::steady_clock::now();
+        std::deque<std::string> inputs;
+        counted_files_t files;
+        if (!options.tracefile.empty())
+        {
+            inputs.push_back(options.tracefile);
+            parse_tracefile(files, options.tracefile, selector);
+        }
+        else if (llvm && options.native)
+        {
+            inputs = find_executables(options.directory);
+            files = read_llvm_coverage<counted_files_t>(
+                inputs, {options.profdata}, selector);
+        }
+        else if (llvm)
+        {
+            inputs = find_executables(options.directory);
+            files = process_files<counted_files_t>(
+                llvm_cov_launcher_t{options.profdata},
+                [&prefix] (auto& files, const auto& buf) {
+                    parse_llvm_json(files, buf, prefix);
+                },
+                inputs,
+                options.j
+            );
+        }
+        else
+        {
+            inputs = find_gcnos(options.directory);
+            files = process_files<counted_files_t>(
+                gcov_launcher_t{},
+                [&prefix] (auto& files, const auto& buf) {
+                    parse_gcov_json(files, buf, prefix);
+                },
+                inputs,
+                options.j
+            );
+        }
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        if (options.output.empty())
+            write(std::cout, options, files);
+        else
+        {
+            std::ofstream out{options.output, std::ios::binary};
+            if (!out)
+                throw std::runtime_error{"cannot open " + options.output};
+            write(out, options, files);
+        }
+
+        if (options.stats)
+            std::cerr << inputs.size() << " inputs, " << files.size() <<
+                " sources in " << elapsed.count() << " s (" <<
+                inputs.size() / elapsed.count() << " inputs/s)" << std::endl;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "vimgcov-cli: " << ex.what() << "\n\n" << usage;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "vimgcov.hpp"
+#include "coverage_sweep.hpp"
+#include "daemon_client.hpp"
+#include "llvm_coverage.hpp"
+#include "tracefile_parser.hpp"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+// the sweep's destructor joins its thread, which waits for the running gcov
+// jobs, python threads go on meanwhile
+struct release_gil_delete_t
+{
+    template<typename T>
+    void operator()(T* p) const
+    {
+        py::gil_scoped_release release;
+        delete p;
+    }
+};
+
+// (lineno, count) pairs flattened into one buffer, exposed to python through
+// the buffer protocol as a read-only (n, 2) uint64 array.
+struct packed_lines_t
+{
+    std::vector<std::uint64_t> data;
+};
+
+std::map<std::string, packed_lines_t> pack(const counted_files_t& files)
+{
+    std::map<std::string, packed_lines_t> rv;
+    for (const auto& [path, lines] : files)
+    {
+        auto& packed = rv[path].data;
+        packed.reserve(lines.size() * 2);
+        for (const auto& [lineno, count] : lines)
+        {
+            packed.push_back(lineno);
+            packed.push_back(count);
+        }
+    }
+    return rv;
+}
+
+PYBIND11_MODULE(_vimgcov, m)
+{
+    py::class_<packed_lines_t>(m, "PackedLines", py::buffer_protocol())
+        .def_buffer([] (packed_lines_t& lines) {
+            return py::buffer_info(
+                lines.data.data(),
+                sizeof(std::uint64_t),
+                py::format_descriptor<std::uint64_t>::format(),
+                2,
+                {lines.data.size() / 2, std::size_t{2}},
+                {2 * sizeof(std::uint64_t), sizeof(std::uint64_t)},
+                true
+            );
+        })
+        .def("__len__", [] (const packed_lines_t& lines) {
+            return lines.data.size() / 2;
+        });
+    // an empty gcov/llvm_cov runs $VIMGCOV_GCOV/$VIMGCOV_LLVM_COV or the
+    // tool in PATH
+    m.def("getcoverage", getcoverage<files_t>,
+          py::arg("gcnos"), py::arg("j"), py::arg("path"),
+          py::arg("gcov") = "");
+    m.def("getllvmcoverage", getllvmcoverage<files_t>,
+          py::arg("executables"), py::arg("unsigned"), py::arg("path"),
+          py::arg("profdata"), py::arg("llvm_cov") = "");
+    m.def("getcoveragecounts",
+          [] (std::deque<std::string> gcnos, unsigned j,
+              const std::string& path, const std::string& gcov) {
+              return pack(getcoverage<counted_files_t>(
+                  std::move(gcnos), j, path, gcov));
+          },
+          py::arg("gcnos"), py::arg("j"), py::arg("path"),
+          py::arg("gcov") = "");
+    m.def("getllvmcoveragecounts",
+          [] (std::deque<std::string> executables, unsigned j,
+              const std::string& path, const std::string& profdata,
+              const std::string& llvm_cov) {
+              return pack(getllvmcoverage<counted_files_t>(
+                  std::move(executables), j, path, profdata, llvm_cov));
+          },
+          py::arg("executables"), py::arg("j"), py::arg("path"),
+          py::arg("profdata"), py::arg("llvm_cov") = "");
+    // releases the GIL while waiting, Vim stays responsive and the sweep
+    // never needs it
+    py::class_<coverage_sweep_t<files_t>,
+               std::unique_ptr<coverage_sweep_t<files_t>,
+                               release_gil_delete_t>>(m, "CoverageSweep")
+        .def(py::init<std::deque<std::string>, unsigned, std::string,
+                      std::string>(),
+             py::arg("gcnos"), py::arg("j"), py::arg("path"),
+             py::arg("gcov") = "")
+        .def("first", &coverage_sweep_t<files_t>::first,
+             py::call_guard<py::gil_scoped_release>())
+        .def("result", &coverage_sweep_t<files_t>::result,
+             py::call_guard<py::gil_scoped_release>())
+        .def("done", &coverage_sweep_t<files_t>::done)
+        .def("cancel", &coverage_sweep_t<files_t>::cancel)
+        .def("cancelled", &coverage_sweep_t<files_t>::cancelled);
+    // None when no vimgcovd listens on socket, "" picks the default path
+    m.def("querydaemon", query_daemon,
+          py::arg("socket"), py::arg("build_dir"), py::arg("path"),
+          py::call_guard<py::gil_scoped_release>());
+    m.def("getnativellvmcoverage",
+          [] (const std::deque<std::string>& executables,
+              const std::deque<std::string>& profiles,
+              const std::string& path) {
+              return read_llvm_coverage<files_t>(
+                  executables, profiles, [&path] (const auto& x) {
+                      return x == path;
+                  });
+          },
+          py::arg("executables"), py::arg("profiles"), py::arg("path"));
+    m.def("getnativellvmcoveragecounts",
+          [] (const std::deque<std::string>& executables,
+              const std::deque<std::string>& profiles,
+              const std::string& path) {
+              return pack(read_llvm_coverage<counted_files_t>(
+                  executables, profiles, [&path] (const auto& x) {
+                      return x == path;
+                  }));
+          },
+          py::arg("executables"), py::arg("profiles"), py::arg("path"));
+    m.def("gettracefilecoverage",
+          [] (const std::string& tracefile, const std::string& path) {
+              files_t files;
+              parse_tracefile(files, tracefile, [&path] (const auto& x) {
+                  return x == path;
+              });
+              return files;
+          },
+          py::arg("tracefile"), py::arg("path"));
+    m.def("gettracefilecoveragecounts",
+          [] (const std::string& tracefile, const std::string& path) {
+              counted_files_t files;
+              parse_tracefile(files, tracefile, [&path] (const auto& x) {
+                  return x == path;
+              });
+              return pack(files);
+          },
+          py::arg("tracefile"), py::arg("path"));
+}
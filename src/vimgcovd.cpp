@@ -0,0 +1,78 @@
+#include "coverage_index.hpp"
+#include "daemon_client.hpp"
+#include "daemon_server.hpp"
+#include <boost/asio/signal_set.hpp>
+#include <csignal>
+#include <iostream>
+
+namespace {
+
+constexpr auto usage = R"(usage: vimgcovd [options]
+
+Keeps the gcov coverage of every build directory it is asked about in
+memory and answers the per-file queries of the editor plugins on a Unix
+socket. A directory is swept again once one of its .gcno or .gcda files
+changed. Without a running daemon the plugin runs gcov itself.
+
+options:
+  --socket PATH  listen on PATH (default: $VIMGCOV_SOCKET,
+                 $XDG_RUNTIME_DIR/vimgcov.sock or /tmp/vimgcov-<uid>.sock)
+  -j N           number of gcov processes, 0 adapts (default)
+  -h, --help     show this help
+)";
+
+struct options_t
+{
+    std::string socket = default_socket_path();
+    unsigned j = 0;
+};
+
+options_t parse_args(int argc, char** argv)
+{
+    options_t options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&] {
+            if (++i == argc)
+                throw std::invalid_argument{"missing value for " + arg};
+            return std::string{argv[i]};
+        };
+        if (arg == "-h" || arg == "--help")
+        {
+            std::cout << usage;
+            std::exit(0);
+        }
+        else if (arg == "--socket")
+            options.socket = value();
+        else if (arg == "-j")
+            options.j = std::stoul(value());
+        else
+            throw std::invalid_argument{"unknown argument " + arg};
+    }
+    return options;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const auto options = parse_args(argc, argv);
+        coverage_index_t index{gcov_launcher(), options.j};
+        daemon_server_t server{options.socket, index};
+        boost::asio::signal_set signals{server.context(), SIGINT, SIGTERM};
+        signals.async_wait([&server] (const boost::system::error_code&, int) {
+            server.stop();
+        });
+        std::cerr << "vimgcovd: listening on " << options.socket << std::endl;
+        server.run();
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "vimgcovd: " << ex.what() << "\n\n" << usage;
+        return 1;
+    }
+    return 0;
+}
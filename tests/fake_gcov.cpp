@@ -0,0 +1,125 @@
+// Stand-in for gcov and llvm-cov in the scale tests. Reads the synthetic
+// gcno (or executable) written by gen_tree, the last argument, sleeps for
+// its delay and prints a report shaped like the real one: gcov's json
+// intermediate format, or llvm-cov's export when the first argument is
+// "export". Execution counts are derived from the TU and line number, so
+// every run of a tree reports the same coverage.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct entry_t
+{
+    std::string path;
+    unsigned lines;
+    unsigned tu;
+};
+
+std::uint64_t count(unsigned tu, unsigned line)
+{
+    // every fifth line is never executed, whichever TU reports it
+    if (line % 5 == 0)
+        return 0;
+    return (tu * 2654435761u + line) % 1000;
+}
+
+void gcov_file(std::string& out, const entry_t& e)
+{
+    out += R"({"file": ")" + e.path + R"(", "functions": [)";
+    for (unsigned line = 1; line <= e.lines; line += 10)
+        out += (line > 1 ? "," : "") + std::string{R"({"name": "_Z1fv)"} +
+            std::to_string(line) + R"(", "demangled_name": "f)" +
+            std::to_string(line) + R"x(()", "start_line": )x" +
+            std::to_string(line) + R"(, "start_column": 1, "end_line": )" +
+            std::to_string(line + 9) + R"(, "end_column": 1, "blocks": 4, )"
+            R"("blocks_executed": 3, "execution_count": )" +
+            std::to_string(count(e.tu, line)) + "}";
+    out += R"(], "lines": [)";
+    for (unsigned line = 1; line <= e.lines; ++line)
+    {
+        const auto c = count(e.tu, line);
+        out += (line > 1 ? "," : "") + std::string{R"({"line_number": )"} +
+            std::to_string(line) + R"(, "function_name": "_Z1fv)" +
+            std::to_string((line - 1) / 10 * 10 + 1) + R"(", "count": )" +
+            std::to_string(c) + R"(, "unexecuted_block": )" +
+            (c ? "false" : "true") + R"(, "block_ids": [2], )"
+            R"("branches": [], "calls": []})";
+    }
+    out += "]}";
+}
+
+void llvm_file(std::string& out, const entry_t& e)
+{
+    out += R"({"filename": ")" + e.path + R"(", "segments": [)";
+    for (unsigned line = 1; line <= e.lines; ++line)
+        out += (line > 1 ? "," : "") + std::string{"["} +
+            std::to_string(line) + ", 5, " +
+            std::to_string(count(e.tu, line)) + ", true, true, false]";
+    out += R"(], "branches": [], "expansions": [], "functions": [)";
+    for (unsigned line = 1; line <= e.lines; line += 10)
+        out += (line > 1 ? "," : "") + std::string{R"({"filename": ")"} +
+            e.path + R"(", "name": "f)" + std::to_string(line) +
+            R"(", "regions": [[)" + std::to_string(line) + ", 1, " +
+            std::to_string(line + 9) + ", 2, " +
+            std::to_string(count(e.tu, line)) + ", 0, 0, 0]]}";
+    out += "]}";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        return 2;
+    const bool llvm = std::string{argv[1]} == "export";
+    std::ifstream in{argv[argc - 1]};
+    if (!in)
+    {
+        std::fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[argc - 1]);
+        return 1;
+    }
+
+    unsigned delay_us = 0;
+    std::vector<entry_t> entries;
+    for (std::string line; std::getline(in, line);)
+    {
+        std::istringstream words{line};
+        std::string key;
+        words >> key;
+        if (key == "delay_us")
+            words >> delay_us;
+        else if (key == "file")
+        {
+            auto& e = entries.emplace_back();
+            words >> e.path >> e.lines >> e.tu;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds{delay_us});
+
+    std::string out;
+    out.reserve(1 << 20);
+    if (llvm)
+        out += R"({"data": [{"files": [)";
+    else
+        out += R"({"format_version": "2", "gcc_version": "13.2.0", )"
+            R"("current_working_directory": "/", "data_file": ")" +
+            std::string{argv[argc - 1]} + R"(", "files": [)";
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        out += i ? "," : "";
+        if (llvm)
+            llvm_file(out, entries[i]);
+        else
+            gcov_file(out, entries[i]);
+    }
+    out += llvm ? R"(], "totals": {}}], "type": "llvm.coverage.json.export",)"
+        R"( "version": "2.0.1"})" : "]}";
+    std::fwrite(out.data(), 1, out.size(), stdout);
+}
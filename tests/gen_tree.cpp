@@ -0,0 +1,70 @@
+// Writes a synthetic build tree for the scale tests: tus gcno files laid out
+// like a CMake build, every TU built from its own source and including
+// headers from a shared pool. The gcnos are text for fake_gcov, which
+// reports one file entry per line of them.
+//
+// usage: gen_tree directory tus [headers per tu] [source lines]
+//                 [header lines] [header pool] [delay us]
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iostream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+struct tree_t
+{
+    unsigned tus = 1000;
+    unsigned headers = 8;
+    unsigned source_lines = 200;
+    unsigned header_lines = 100;
+    unsigned pool = 100;
+    unsigned delay_us = 0;
+};
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: gen_tree directory tus [headers per tu] "
+            "[source lines] [header lines] [header pool] [delay us]\n";
+        return 2;
+    }
+    const fs::path root = fs::absolute(argv[1]);
+    tree_t t;
+    unsigned* params[] = {&t.tus, &t.headers, &t.source_lines,
+                          &t.header_lines, &t.pool, &t.delay_us};
+    for (int i = 2; i < argc && i <= 7; ++i)
+        *params[i - 2] = std::stoul(argv[i]);
+
+    fs::remove_all(root);
+    for (unsigned tu = 0; tu < t.tus; ++tu)
+    {
+        // a hundred TUs per module directory
+        const auto module = "module_" + std::to_string(tu / 100);
+        const auto name = "tu_" + std::to_string(tu) + ".cpp";
+        const auto dir = root / "build/CMakeFiles/app.dir/src" / module;
+        fs::create_directories(dir);
+        std::ofstream gcno{(dir / (name + ".gcno")).string()};
+        gcno << "delay_us " << t.delay_us << "\n" <<
+            "file " << (root / "src" / module / name).string() << " " <<
+            t.source_lines << " " << tu << "\n";
+        for (unsigned h = 0; h < t.headers; ++h)
+        {
+            // neighbouring TUs share most of their headers
+            const auto header = (tu / 10 + h * 7) % t.pool;
+            gcno << "file " << (root / "include" / ("header_" +
+                std::to_string(header) + ".hpp")).string() << " " <<
+                t.header_lines << " " << tu << "\n";
+        }
+        if (!gcno)
+        {
+            std::cerr << "gen_tree: cannot write " << dir << "\n";
+            return 1;
+        }
+    }
+    std::cout << t.tus << " TUs in " << root << "\n";
+}
@@ -0,0 +1,72 @@
+#include "concurrency.hpp"
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(test_concurrency, available_cpus)
+{
+    const auto cpus = available_cpus();
+    EXPECT_GE(cpus, 1u);
+    EXPECT_LE(cpus, std::max(1u, std::thread::hardware_concurrency()));
+}
+
+TEST(test_concurrency, available_memory)
+{
+    EXPECT_GT(available_memory(), 0u);
+}
+
+TEST(test_concurrency, starts_at_cpus)
+{
+    EXPECT_EQ(adaptive_limit_t{8}.limit(), 8u);
+    EXPECT_EQ(adaptive_limit_t{0}.limit(), 1u);
+}
+
+TEST(test_concurrency, cpu_bound_keeps_cpus)
+{
+    adaptive_limit_t limit{8};
+    for (int i = 0; i < 10; ++i)
+        limit.update(1s, 8s, 8, 0, 0);
+    EXPECT_EQ(limit.limit(), 8u);
+}
+
+TEST(test_concurrency, io_bound_grows)
+{
+    adaptive_limit_t limit{8};
+    limit.update(1s, 4s, 8, 0, 0);
+    EXPECT_GT(limit.limit(), 8u);
+    for (int i = 0; i < 10; ++i)
+        limit.update(1s, 100ms, 8, 0, 0);
+    EXPECT_EQ(limit.limit(), 8u * adaptive_limit_t::oversubscription);
+    for (int i = 0; i < 10; ++i)
+        limit.update(1s, 8s, 32, 0, 0);
+    EXPECT_EQ(limit.limit(), 8u);
+}
+
+TEST(test_concurrency, memory_ceiling)
+{
+    adaptive_limit_t limit{8};
+    constexpr std::uint64_t gb = 1 << 30;
+    limit.update(1s, 8s, 8, 2 * gb, 6 * gb);
+    EXPECT_EQ(limit.limit(), 3u);
+    limit.update(1s, 3s, 3, 2 * gb, gb);
+    EXPECT_EQ(limit.limit(), 1u);
+}
+
+// Test that the memory ceiling comes from the children of the batch, a
+// large one earlier doesn't cap the later batches
+TEST(test_concurrency, memory_ceiling_per_batch)
+{
+    adaptive_limit_t limit{8};
+    rusage huge{};
+    huge.ru_maxrss = 1l << 40; // KiB
+    limit.start_batch();
+    limit.reaped(huge);
+    limit.end_batch(1);
+    EXPECT_EQ(limit.limit(), 1u);
+    limit.start_batch();
+    limit.reaped(rusage{});
+    limit.end_batch(1);
+    EXPECT_GT(limit.limit(), 1u);
+}
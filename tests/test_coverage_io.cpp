@@ -0,0 +1,67 @@
+#include "coverage_io.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+namespace {
+
+const counted_files_t files{
+    {"/src/a.cpp", {{1, 3}, {2, 0}, {10, 18446744073709551615u}}},
+    {"/src/b \"quoted\".hpp", {{7, 1}}},
+    {"/src/empty.hpp", {}},
+};
+
+}
+
+TEST(test_coverage_io, json_reads_back_with_gcov_parser)
+{
+    std::ostringstream out;
+    write_json(out, files);
+    counted_files_t parsed;
+    parse_gcov_json(parsed, out.str(), nullptr);
+    EXPECT_EQ(parsed, files);
+}
+
+TEST(test_coverage_io, lcov)
+{
+    std::ostringstream out;
+    write_lcov(out, files);
+    EXPECT_EQ(out.str(),
+              "TN:\n"
+              "SF:/src/a.cpp\n"
+              "DA:1,3\n"
+              "DA:2,0\n"
+              "DA:10,18446744073709551615\n"
+              "LF:3\n"
+              "LH:2\n"
+              "end_of_record\n"
+              "SF:/src/b \"quoted\".hpp\n"
+              "DA:7,1\n"
+              "LF:1\n"
+              "LH:1\n"
+              "end_of_record\n");
+}
+
+TEST(test_coverage_io, binary_round_trip)
+{
+    std::stringstream buf;
+    write_binary(buf, files);
+    EXPECT_EQ(buf.str().substr(0, 4), "VGCV");
+    EXPECT_EQ(read_binary(buf), files);
+}
+
+TEST(test_coverage_io, binary_truncated)
+{
+    std::stringstream buf;
+    write_binary(buf, files);
+    std::istringstream truncated{buf.str().substr(0, buf.str().size() - 1)};
+    EXPECT_THROW(read_binary(truncated), parse_exception);
+    std::istringstream garbage{"not coverage"};
+    EXPECT_THROW(read_binary(garbage), parse_exception);
+    // corrupt sizes of a path and of the lines of a file
+    std::istringstream huge_path{std::string{"VGCV\1\0\0\0\1\0\0\0"
+                                             "\xff\xff\xff\xff/a", 18}};
+    EXPECT_THROW(read_binary(huge_path), parse_exception);
+    std::istringstream huge_lines{std::string{"VGCV\1\0\0\0\1\0\0\0"
+                                              "\1\0\0\0a\xff\xff\xff\xff", 21}};
+    EXPECT_THROW(read_binary(huge_lines), parse_exception);
+}
@@ -0,0 +1,166 @@
+#include "coverage_index.hpp"
+#include "daemon_client.hpp"
+#include "daemon_protocol.hpp"
+#include "daemon_server.hpp"
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+// gcov stand-in printing the gcno, which holds the json report
+const spawn_launcher_t cat_launcher{PYTHON_EXECUTABLE, {
+    "-c", "import sys; sys.stdout.write(open(sys.argv[1]).read())"}};
+
+std::string report(const std::string& path, unsigned count)
+{
+    return R"({"files": [{"file": ")" + path + R"(", "lines": [)"
+        R"({"line_number": 1, "count": )" + std::to_string(count) +
+        R"(, "unexecuted_block": )" + (count ? "false" : "true") + "}]}]}";
+}
+
+struct temp_dir_t
+{
+    temp_dir_t()
+        : path{fs::temp_directory_path() / fs::unique_path("vimgcov-%%%%%%")}
+    {
+        fs::create_directories(path);
+    }
+    ~temp_dir_t() { fs::remove_all(path); }
+    void write(const std::string& name, const std::string& content) const
+    {
+        std::ofstream{(path / name).string()} << content;
+    }
+    fs::path path;
+};
+
+}
+
+TEST(test_daemon, protocol_round_trip)
+{
+    const coverage_request_t request{"/build", "/src/a.cpp"};
+    const auto decoded_request = decode_request(encode_request(request));
+    EXPECT_EQ(decoded_request.build_dir, request.build_dir);
+    EXPECT_EQ(decoded_request.path, request.path);
+
+    coverage_response_t response;
+    response.lines = {{1, false}, {2, true}, {4000000000u, false}};
+    const auto payload = encode_response(response);
+    EXPECT_EQ(payload.size(), 16u + 3 * 5);
+    const auto decoded = decode_response(payload);
+    EXPECT_EQ(decoded.status, coverage_response_t::ok);
+    EXPECT_EQ(decoded.lines, response.lines);
+
+    response = {coverage_response_t::error, {}, "no such directory"};
+    const auto error = decode_response(encode_response(response));
+    EXPECT_EQ(error.status, coverage_response_t::error);
+    EXPECT_EQ(error.message, "no such directory");
+
+    EXPECT_THROW(decode_response(encode_request(request)), parse_exception);
+    EXPECT_THROW(decode_response(payload.substr(0, payload.size() - 1)),
+                 parse_exception);
+}
+
+// Test that the index sweeps once and again only after a gcno changed
+TEST(test_daemon, coverage_index)
+{
+    temp_dir_t dir;
+    dir.write("a.gcno", report("/src/a.cpp", 1));
+    dir.write("b.gcno", report("/src/a.cpp", 2));
+    unsigned launched = 0;
+    coverage_index_t index{
+        [&launched] (const auto& file, auto& ap_err, auto& ap_out, auto& ctx) {
+            ++launched;
+            return cat_launcher(file, ap_err, ap_out, ctx);
+        }, 1};
+
+    const lines_t covered{{1, false}};
+    EXPECT_EQ(index.lines(dir.path.string(), "/src/a.cpp"), covered);
+    EXPECT_EQ(index.lines(dir.path.string(), "/src/b.cpp"), std::nullopt);
+    EXPECT_EQ(launched, 2u);
+
+    dir.write("a.gcno", report("/src/b.cpp", 0));
+    const lines_t uncovered{{1, true}};
+    EXPECT_EQ(index.lines(dir.path.string(), "/src/b.cpp"), uncovered);
+    EXPECT_EQ(launched, 4u);
+
+    fs::remove(dir.path / "a.gcno");
+    EXPECT_EQ(index.lines(dir.path.string(), "/src/b.cpp"), std::nullopt);
+    EXPECT_EQ(launched, 5u);
+}
+
+TEST(test_daemon, query)
+{
+    temp_dir_t dir;
+    dir.write("a.gcno", report("/src/a.cpp", 3));
+    const auto socket = (dir.path / "vimgcov.sock").string();
+    EXPECT_EQ(query_daemon(socket, dir.path.string(), "/src/a.cpp"),
+              std::nullopt);
+
+    coverage_index_t index{cat_launcher, 1};
+    std::optional<daemon_server_t> server{std::in_place, socket, index};
+    EXPECT_EQ(fs::status(socket).permissions(),
+              fs::owner_read | fs::owner_write);
+    EXPECT_THROW((daemon_server_t{socket, index}), std::runtime_error);
+    std::thread thread{[&server] { server->run(); }};
+
+    const files_t expected{{"/src/a.cpp", {{1, false}}}};
+    EXPECT_EQ(query_daemon(socket, dir.path.string(), "/src/a.cpp"),
+              expected);
+    EXPECT_EQ(query_daemon(socket, dir.path.string(), "/src/b.cpp"),
+              files_t{});
+    EXPECT_THROW(query_daemon(socket, (dir.path / "missing").string(),
+                              "/src/a.cpp"),
+                 std::runtime_error);
+
+    server->stop();
+    thread.join();
+    server.reset();
+    EXPECT_FALSE(fs::exists(socket));
+    EXPECT_EQ(query_daemon(socket, dir.path.string(), "/src/a.cpp"),
+              std::nullopt);
+}
+
+// Test that a client not sending its request is dropped after the timeout
+// and that stop() doesn't wait for one
+TEST(test_daemon, idle_client)
+{
+    temp_dir_t dir;
+    const auto socket = (dir.path / "vimgcov.sock").string();
+    coverage_index_t index{cat_launcher, 1};
+    boost::asio::io_context ctx;
+    using namespace std::chrono_literals;
+
+    for (const auto timeout : {100ms, std::chrono::milliseconds{1h}})
+    {
+        std::optional<daemon_server_t> server{std::in_place, socket, index,
+                                              timeout};
+        std::thread thread{[&server] { server->run(); }};
+        boost::asio::local::stream_protocol::socket client{ctx};
+        client.connect(socket);
+        // a query answered after the idle client connected shows the
+        // server accepted it
+        EXPECT_EQ(query_daemon(socket, dir.path.string(), "/src/a.cpp"),
+                  files_t{});
+        const auto start = std::chrono::steady_clock::now();
+        if (timeout == 100ms)
+        {
+            try
+            {
+                read_frame(client, 10s);
+                ADD_FAILURE() << "idle client got a response";
+            }
+            catch (const boost::system::system_error& ex)
+            {
+                EXPECT_EQ(ex.code(), boost::asio::error::eof);
+            }
+        }
+        server->stop();
+        thread.join();
+        server.reset();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, 10s);
+    }
+}
@@ -0,0 +1,73 @@
+#include "files_merge.hpp"
+#include <gtest/gtest.h>
+
+TEST(test_files_merge, merge_files)
+{
+    counted_files_t into{
+        {"a.hpp", {{1, 1}, {3, 0}}},
+        {"b.cpp", {{2, 5}}},
+    };
+    counted_files_t from{
+        {"a.hpp", {{1, 2}, {2, 7}}},
+        {"c.cpp", {{4, 0}}},
+    };
+    merge_files(into, std::move(from));
+    const counted_files_t expected{
+        {"a.hpp", {{1, 3}, {2, 7}, {3, 0}}},
+        {"b.cpp", {{2, 5}}},
+        {"c.cpp", {{4, 0}}},
+    };
+    EXPECT_EQ(into, expected);
+    EXPECT_TRUE(from.empty());
+}
+
+TEST(test_files_merge, reduce_files_empty)
+{
+    EXPECT_TRUE(reduce_files(std::vector<files_t>{}, 4).empty());
+    EXPECT_TRUE(reduce_files(std::vector<files_t>(3), 4).empty());
+}
+
+TEST(test_files_merge, reduce_files_single_partial_untouched)
+{
+    // lines aren't deduplicated when a file comes from one partial only
+    const files_t partial{{"a", {{0, false}, {0, false}}}};
+    EXPECT_EQ(reduce_files(std::vector<files_t>{{}, partial, {}}, 2),
+              partial);
+}
+
+class test_files_merge_threads : public ::testing::TestWithParam<unsigned> {};
+
+TEST_P(test_files_merge_threads, matches_serial_merge)
+{
+    // every partial reports the shared headers and its own source
+    std::vector<counted_files_t> partials(13);
+    for (unsigned p = 0; p < partials.size(); ++p)
+    {
+        for (unsigned h = 0; h < 20; ++h)
+            for (unsigned l = h % 3; l < 30; l += 1 + (p + h) % 4)
+                partials[p]["header" + std::to_string(h) + ".hpp"]
+                    .emplace_back(l, p * l);
+        partials[p]["source" + std::to_string(p) + ".cpp"] = {{1, p}};
+    }
+    counted_files_t expected;
+    for (auto partial : partials)
+        merge_files(expected, std::move(partial));
+
+    const auto rv = reduce_files(partials, GetParam());
+    EXPECT_EQ(rv, expected);
+    EXPECT_EQ(rv.size(), 20u + partials.size());
+}
+
+INSTANTIATE_TEST_SUITE_P(test_files_merge_threads_inst,
+                         test_files_merge_threads,
+                         ::testing::Values(1u, 2u, 3u, 8u, 32u));
+
+TEST(test_files_merge, unexecuted)
+{
+    std::vector<files_t> partials{
+        {{"a", {{1, true}, {2, true}}}},
+        {{"a", {{1, false}, {3, true}}}},
+    };
+    const files_t expected{{"a", {{1, false}, {2, true}, {3, true}}}};
+    EXPECT_EQ(reduce_files(partials, 2), expected);
+}
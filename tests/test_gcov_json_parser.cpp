@@ -489,3 +489,131 @@ TEST(ParseGcovJsonTest, UnexecutedBlockIsNotBool)
     EXPECT_THROW_WITH_MSG(parse_gcov_json(out, json, filename_selector),
                           "Unexecuted block isn't boolean");
 }
+
+// Test that counts of the same line are summed across TUs
+TEST(ParseGcovJsonTest, CountsSummedAcrossTUs)
+{
+    counted_files_t out;
+    parse_gcov_json(out, R"({
+        "files": [{
+            "file": "testfile.c",
+            "lines": [{
+                "line_number": 3,
+                "unexecuted_block": false,
+                "count": 2
+            }, {
+                "line_number": 1,
+                "unexecuted_block": false,
+                "count": 5
+            }, {
+                "line_number": 1,
+                "unexecuted_block": false,
+                "count": 1
+            }]
+        }]
+    })", filename_selector);
+    parse_gcov_json(out, R"({
+        "files": [{
+            "file": "testfile.c",
+            "lines": [{
+                "line_number": 2,
+                "unexecuted_block": true,
+                "count": 0
+            }, {
+                "line_number": 3,
+                "unexecuted_block": false,
+                "count": 8589934592
+            }]
+        }]
+    })", filename_selector);
+    const counted_lines_t expected{{1, 6}, {2, 0}, {3, 8589934594}};
+    EXPECT_EQ(out["testfile.c"], expected);
+}
+
+// Test that summing counts saturates instead of wrapping around
+TEST(ParseGcovJsonTest, CountsSaturate)
+{
+    counted_files_t out;
+    const std::string json = R"({
+        "files": [{
+            "file": "testfile.c",
+            "lines": [{
+                "line_number": 1,
+                "unexecuted_block": false,
+                "count": 18446744073709551615
+            }]
+        }]
+    })";
+    parse_gcov_json(out, json, filename_selector);
+    parse_gcov_json(out, json, filename_selector);
+    const counted_lines_t expected{{1, 18446744073709551615u}};
+    EXPECT_EQ(out["testfile.c"], expected);
+}
+
+// Test that segments and regions of one llvm file entry aren't counted
+// twice while separate exports are summed
+TEST(ParseLlvmJsonTest, Counts)
+{
+    counted_files_t out;
+    const std::string json = R"({
+        "data": [{
+            "files": [{
+                "filename": "testfile.c",
+                "segments": [
+                    [4, 1, 3, true, true, false],
+                    [5, 1, 0, true, true, false],
+                    [6, 1, 7, true, true, true]
+                ],
+                "functions": [{
+                    "filename": "testfile.c",
+                    "regions": [
+                        [4, 1, 6, 2, 3, 0, 0, 0],
+                        [7, 1, 8, 2, 1, 0, 0, 0]
+                    ]
+                }]
+            }]
+        }]
+    })";
+    parse_llvm_json(out, json, filename_selector);
+    const counted_lines_t expected{{4, 3}, {5, 0}, {7, 1}};
+    EXPECT_EQ(out["testfile.c"], expected);
+    parse_llvm_json(out, json, filename_selector);
+    const counted_lines_t expected_twice{{4, 6}, {5, 0}, {7, 2}};
+    EXPECT_EQ(out["testfile.c"], expected_twice);
+
+    files_t unexecuted;
+    parse_llvm_json(unexecuted, json, filename_selector);
+    const lines_t expected_unexecuted{{4, false}, {5, true}, {7, false}};
+    EXPECT_EQ(unexecuted["testfile.c"], expected_unexecuted);
+}
+
+// Test that the functions of two template instantiations covering the same
+// line are summed, nested regions of one of them aren't
+TEST(ParseLlvmJsonTest, InstantiationsSummed)
+{
+    counted_files_t out;
+    parse_llvm_json(out, R"({
+        "data": [{
+            "files": [{
+                "filename": "testfile.c",
+                "segments": [
+                    [2, 1, 1, true, true, false]
+                ],
+                "functions": [{
+                    "filename": "testfile.c",
+                    "regions": [
+                        [2, 1, 4, 2, 2, 0, 0, 0],
+                        [2, 10, 2, 20, 1, 0, 0, 0]
+                    ]
+                }, {
+                    "filename": "testfile.c",
+                    "regions": [
+                        [2, 1, 4, 2, 3, 0, 0, 0]
+                    ]
+                }]
+            }]
+        }]
+    })", filename_selector);
+    const counted_lines_t expected{{2, 5}};
+    EXPECT_EQ(out["testfile.c"], expected);
+}
@@ -0,0 +1,42 @@
+#include "job_ranking.hpp"
+#include <gtest/gtest.h>
+
+TEST(RankBySimilarityTest, Order)
+{
+    std::deque<std::string> gcnos{
+        "build/CMakeFiles/app.dir/src/main.cpp.gcno",
+        "build/foo.gcno",
+        "build/CMakeFiles/app.dir/other/foo.cpp.gcno",
+        "build/.libs/libapp_la-foo.gcno",
+        "build/CMakeFiles/app.dir/src/foo.cpp.gcno",
+        "build/CMakeFiles/app.dir/src/bar.cpp.gcno",
+        "build/CMakeFiles/app.dir/src/barfoo.cpp.gcno",
+    };
+    EXPECT_EQ(rank_by_similarity(gcnos, "/home/user/app/src/foo.cpp"), 3u);
+    const std::deque<std::string> expected{
+        "build/CMakeFiles/app.dir/src/main.cpp.gcno",
+        "build/CMakeFiles/app.dir/src/bar.cpp.gcno",
+        "build/CMakeFiles/app.dir/src/barfoo.cpp.gcno",
+        "build/.libs/libapp_la-foo.gcno",
+        "build/foo.gcno",
+        "build/CMakeFiles/app.dir/other/foo.cpp.gcno",
+        "build/CMakeFiles/app.dir/src/foo.cpp.gcno",
+    };
+    EXPECT_EQ(gcnos, expected);
+}
+
+TEST(RankBySimilarityTest, Empty)
+{
+    std::deque<std::string> gcnos;
+    EXPECT_EQ(rank_by_similarity(gcnos, "foo.cpp"), 0u);
+    EXPECT_TRUE(gcnos.empty());
+}
+
+TEST(RankBySimilarityTest, NoMatch)
+{
+    std::deque<std::string> gcnos{"build/a.cpp.gcno", "build/b.cpp.gcno"};
+    EXPECT_EQ(rank_by_similarity(gcnos, "include/common.hpp"), 0u);
+    const std::deque<std::string> expected{"build/a.cpp.gcno",
+                                           "build/b.cpp.gcno"};
+    EXPECT_EQ(gcnos, expected);
+}
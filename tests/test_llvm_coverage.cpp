@@ -0,0 +1,331 @@
+#include "llvm_coverage.hpp"
+#include "instr_profile.hpp"
+#include "md5.hpp"
+#include <gtest/gtest.h>
+#include <elf.h>
+#include <fstream>
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+
+namespace {
+
+template<typename T>
+void put(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_uleb128(std::string& out, std::uint64_t value)
+{
+    do
+    {
+        std::uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value)
+            byte |= 0x80;
+        out.push_back(byte);
+    } while (value);
+}
+
+void pad(std::string& out, std::size_t alignment)
+{
+    out.resize((out.size() + alignment - 1) / alignment * alignment);
+}
+
+constexpr std::uint64_t func_hash = 0x1234;
+
+// three v8 raw profile records, foo counts {6, 1}, bar counts {2} and
+// baz counts {3}
+std::string profraw_v8()
+{
+    const std::uint64_t counters_delta = 0x1000;
+    std::string out;
+    for (const std::uint64_t word : std::initializer_list<std::uint64_t>{
+            0xff6c70726f667281, 8, 0, 3, 0, 4, 0, 0, counters_delta, 0, 1})
+        put(out, word);
+    // counter pointers are relative to their record
+    const std::uint64_t foo_counters = counters_delta;
+    const std::uint64_t bar_counters = counters_delta - 48 + 16;
+    const std::uint64_t baz_counters = counters_delta - 96 + 24;
+    for (const auto& [name, counters, num] : {
+            std::tuple{"foo", foo_counters, 2u},
+            std::tuple{"bar", bar_counters, 1u},
+            std::tuple{"baz", baz_counters, 1u}})
+    {
+        put(out, md5_hash(name));
+        put(out, func_hash);
+        put(out, counters);
+        put<std::uint64_t>(out, 0);
+        put<std::uint64_t>(out, 0);
+        put<std::uint32_t>(out, num);
+        put<std::uint32_t>(out, 0);
+    }
+    for (const std::uint64_t counter : {6, 1, 2, 3})
+        put(out, counter);
+    return out;
+}
+
+// v10 indexed profile with foo counts {4, 3}
+std::string profdata_v10()
+{
+    std::string out;
+    put<std::uint64_t>(out, 0x8169666f72706cff);
+    put<std::uint64_t>(out, 10);
+    put<std::uint64_t>(out, 0);
+    put<std::uint64_t>(out, 0);
+    const auto hash_offset = out.size();
+    put<std::uint64_t>(out, 0);
+    put<std::uint64_t>(out, 0);
+    put<std::uint64_t>(out, 0);
+    put<std::uint64_t>(out, 0);
+    // summary with one field and one cutoff
+    put<std::uint64_t>(out, 1);
+    put<std::uint64_t>(out, 1);
+    for (int i = 0; i < 4; ++i)
+        put<std::uint64_t>(out, 0);
+
+    std::string record;
+    put<std::uint64_t>(record, func_hash);
+    put<std::uint64_t>(record, 2);
+    put<std::uint64_t>(record, 4);
+    put<std::uint64_t>(record, 3);
+    put<std::uint32_t>(record, 8);
+    put<std::uint32_t>(record, 0);
+    put<std::uint16_t>(out, 1);
+    put<std::uint64_t>(out, 0);
+    put<std::uint64_t>(out, 3);
+    put<std::uint64_t>(out, record.size());
+    out += "foo" + record;
+
+    pad(out, 8);
+    const std::uint64_t table = out.size();
+    std::memcpy(out.data() + hash_offset, &table, sizeof(table));
+    put<std::uint64_t>(out, 1);
+    put<std::uint64_t>(out, 1);
+    return out;
+}
+
+std::string filenames(const std::vector<std::string>& names, bool compress)
+{
+    std::string encoded;
+    for (const auto& name : names)
+    {
+        put_uleb128(encoded, name.size());
+        encoded += name;
+    }
+    std::string out;
+    put_uleb128(out, names.size());
+    put_uleb128(out, encoded.size());
+    if (!compress)
+    {
+        put_uleb128(out, 0);
+        return out + encoded;
+    }
+    std::string compressed(compressBound(encoded.size()), '\0');
+    auto size = static_cast<uLongf>(compressed.size());
+    ::compress(reinterpret_cast<Bytef*>(compressed.data()), &size,
+               reinterpret_cast<const Bytef*>(encoded.data()), encoded.size());
+    compressed.resize(size);
+    put_uleb128(out, compressed.size());
+    return out + compressed;
+}
+
+void put_region(std::string& out, std::uint64_t header, unsigned line_delta,
+                bool gap = false)
+{
+    put_uleb128(out, header);
+    put_uleb128(out, line_delta);
+    put_uleb128(out, 1);
+    put_uleb128(out, 0);
+    put_uleb128(out, gap ? 1u << 31 | 2 : 2);
+}
+
+// foo in src/main.rs relative to the compilation dir of a version 6 covmap
+// record, bar and baz, two instantiations of the same generic, in a version
+// 4 record with compressed filenames
+std::string covmap_sections(std::string& covfun)
+{
+    std::string covmap;
+    const auto put_record = [&covmap] (const std::string& blob,
+                                       std::uint32_t version) {
+        put<std::uint32_t>(covmap, 0);
+        put<std::uint32_t>(covmap, blob.size());
+        put<std::uint32_t>(covmap, 0);
+        put<std::uint32_t>(covmap, version);
+        covmap += blob;
+        pad(covmap, 8);
+        return md5_hash(blob);
+    };
+    const auto foo_filenames = put_record(
+        filenames({"/work", "src/main.rs"}, false), 5);
+    const auto bar_filenames = put_record(
+        filenames({"/work/src/lib.rs"}, true), 3);
+
+    const auto put_function = [&covfun] (const char* name,
+                                         std::uint64_t filenames_ref,
+                                         const std::string& mapping) {
+        put(covfun, md5_hash(name));
+        put<std::uint32_t>(covfun, mapping.size());
+        put(covfun, func_hash);
+        put(covfun, filenames_ref);
+        covfun += mapping;
+        pad(covfun, 8);
+    };
+
+    std::string foo;
+    put_uleb128(foo, 1);
+    put_uleb128(foo, 1);
+    // one expression: counter 0 - counter 1
+    put_uleb128(foo, 1);
+    put_uleb128(foo, 0 << 2 | 1);
+    put_uleb128(foo, 1 << 2 | 1);
+    put_uleb128(foo, 7);
+    put_region(foo, 0 << 2 | 1, 1);       // line 1: counter 0
+    put_region(foo, 0 << 2 | 2, 1);       // line 2: expression 0
+    put_region(foo, 1 << 2 | 1, 1, true); // line 3: gap
+    put_region(foo, 1 << 2 | 1, 0);       // line 3: counter 1
+    put_region(foo, 2 << 3, 2);           // line 5: skipped
+    put_region(foo, 4 << 3, 0);           // line 5: branch
+    put_uleb128(foo, 1);
+    put_uleb128(foo, 0);
+    put_region(foo, 0, 1);                // line 6: zero
+    put_function("foo", foo_filenames, foo);
+
+    std::string bar;
+    put_uleb128(bar, 1);
+    put_uleb128(bar, 0);
+    put_uleb128(bar, 0);
+    put_uleb128(bar, 1);
+    put_region(bar, 0 << 2 | 1, 10);
+    put_function("bar", bar_filenames, bar);
+    put_function("baz", bar_filenames, bar);
+    return covmap;
+}
+
+std::string elf()
+{
+    std::string covfun;
+    const auto covmap = covmap_sections(covfun);
+    const std::string& functions = covfun;
+    const std::string names{"\0.shstrtab\0__llvm_covmap\0__llvm_covfun\0", 40};
+
+    std::string out(sizeof(Elf64_Ehdr), '\0');
+    std::vector<Elf64_Shdr> sections(4, Elf64_Shdr{});
+    for (const auto& [index, name, contents] : {
+            std::tuple{1, 1u, &names},
+            std::tuple{2, 11u, &covmap},
+            std::tuple{3, 25u, &functions}})
+    {
+        pad(out, 8);
+        sections[index].sh_name = name;
+        sections[index].sh_type = index == 1 ? SHT_STRTAB : SHT_PROGBITS;
+        sections[index].sh_offset = out.size();
+        sections[index].sh_size = contents->size();
+        out += *contents;
+    }
+    pad(out, 8);
+    Elf64_Ehdr header{};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_type = ET_EXEC;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_ehsize = sizeof(header);
+    header.e_shoff = out.size();
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = sections.size();
+    header.e_shstrndx = 1;
+    std::memcpy(out.data(), &header, sizeof(header));
+    for (const auto& section : sections)
+        put(out, section);
+    return out;
+}
+
+class LlvmCoverageTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        boost::filesystem::create_directories(dir_);
+    }
+    void TearDown() override
+    {
+        boost::filesystem::remove_all(dir_);
+    }
+    std::string write(const std::string& name, const std::string& contents)
+    {
+        const auto path = (dir_ / name).string();
+        std::ofstream{path, std::ios::binary} << contents;
+        return path;
+    }
+    const boost::filesystem::path dir_ =
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path();
+};
+
+}
+
+TEST(Md5Test, LowWord)
+{
+    EXPECT_EQ(md5_hash(""), 0x04b2008fd98c1dd4u);
+    EXPECT_EQ(md5_hash("abc"), 0xb04fd23c98500190u);
+    EXPECT_EQ(md5_hash(std::string(1000, 'a')),
+              md5_hash(std::string(1000, 'a')));
+    EXPECT_NE(md5_hash(std::string(64, 'a')), md5_hash(std::string(65, 'a')));
+}
+
+TEST(InstrProfileTest, RawAndIndexedSummed)
+{
+    profile_counters_t counters;
+    read_profraw(counters, profraw_v8());
+    read_profdata(counters, profdata_v10());
+    const profile_counters_t expected{
+        {{md5_hash("foo"), func_hash}, {10, 4}},
+        {{md5_hash("bar"), func_hash}, {2}},
+        {{md5_hash("baz"), func_hash}, {3}},
+    };
+    EXPECT_EQ(counters, expected);
+}
+
+TEST(InstrProfileTest, Invalid)
+{
+    profile_counters_t counters;
+    auto raw = profraw_v8();
+    EXPECT_THROW(read_profraw(counters, raw.substr(0, raw.size() - 1)),
+                 parse_exception);
+    raw[8] = 4;
+    EXPECT_THROW(read_profraw(counters, raw), parse_exception);
+    raw[8] = 8;
+    // counter pointer past the counters
+    raw[11 * 8 + 16] = 0x40;
+    EXPECT_THROW(read_profraw(counters, raw), parse_exception);
+    EXPECT_THROW(read_profdata(counters, profraw_v8()), parse_exception);
+}
+
+TEST_F(LlvmCoverageTest, Lines)
+{
+    const auto executable = write("bin", elf());
+    const auto script = write("script.sh", "#!/bin/sh\n");
+    const auto profraw = write("a.profraw", profraw_v8());
+    const auto profdata = write("b.profdata", profdata_v10());
+    write("empty.profraw", "");
+
+    const auto files = read_llvm_coverage<counted_files_t>(
+        {executable, script, executable},
+        {profraw, profdata, (dir_ / "empty.profraw").string()},
+        [] (const auto&) { return true; });
+    const counted_files_t expected{
+        {"/work/src/main.rs", {{1, 10}, {2, 6}, {3, 4}, {6, 0}}},
+        {"/work/src/lib.rs", {{10, 5}}},
+    };
+    EXPECT_EQ(files, expected);
+
+    const auto selected = read_llvm_coverage<files_t>(
+        {executable}, {profdata}, [] (const auto& x) {
+            return x == "/work/src/lib.rs";
+        });
+    const files_t expected_selected{{"/work/src/lib.rs", {{10, true}}}};
+    EXPECT_EQ(selected, expected_selected);
+}
@@ -0,0 +1,126 @@
+// Latency and peak RSS of the coverage sweeps on a tree from gen_tree, with
+// fake_gcov standing in for gcov/llvm-cov. Fails when a sweep takes longer
+// than max seconds or the process peaked above max MiB, and when the
+// reported lines aren't the ones fake_gcov generated.
+//
+// usage: test_scale directory tool max_seconds max_rss_mib [--llvm]
+#include "coverage_index.hpp"
+#include "vimgcov.hpp"
+#include <boost/filesystem.hpp>
+#include <sys/resource.h>
+#include <chrono>
+#include <iostream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+double max_rss_mib(int who)
+{
+    struct rusage usage;
+    ::getrusage(who, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+template<typename F>
+auto timed(double& seconds, F f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto rv = f();
+    seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return rv;
+}
+
+// fake_gcov leaves every fifth line unexecuted
+bool expected_lines(const lines_t& lines)
+{
+    if (lines.empty())
+        return false;
+    for (std::size_t i = 0; i < lines.size(); ++i)
+    {
+        const auto& [lineno, unexecuted] = lines[i];
+        if (lineno != i + 1 || unexecuted != (lineno % 5 == 0))
+            return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 5)
+    {
+        std::cerr << "usage: test_scale directory tool max_seconds "
+            "max_rss_mib [--llvm]\n";
+        return 2;
+    }
+    const fs::path root = fs::absolute(argv[1]);
+    const std::string tool = argv[2];
+    const double max_seconds = std::stod(argv[3]);
+    const double max_rss = std::stod(argv[4]);
+    const bool llvm = argc > 5 && std::string{argv[5]} == "--llvm";
+
+    std::deque<std::string> gcnos;
+    for (const auto& entry : fs::recursive_directory_iterator(root))
+        if (entry.path().extension() == ".gcno")
+            gcnos.push_back(entry.path().string());
+    const auto source = (root / "src/module_0/tu_0.cpp").string();
+    const auto header = (root / "include/header_0.hpp").string();
+
+    bool ok = true;
+    const auto check = [&] (const char* what, double seconds,
+                            const files_t& files, const std::string& path) {
+        const auto it = files.find(path);
+        const bool lines_ok = it != files.end() && expected_lines(it->second);
+        std::cout << what << ": " << seconds << " s, peak RSS so far " <<
+            max_rss_mib(RUSAGE_SELF) << " MiB" <<
+            (lines_ok ? "" : ", unexpected lines") << std::endl;
+        ok &= lines_ok && seconds <= max_seconds;
+    };
+
+    double seconds;
+    if (llvm)
+    {
+        // the gcnos stand in for the executables, the profdata is unused
+        auto files = timed(seconds, [&] {
+            return getllvmcoverage(gcnos, 0, header, "unused.profdata",
+                                   tool);
+        });
+        check("llvm-cov sweep for a header", seconds, files, header);
+    }
+    else
+    {
+        auto files = timed(seconds, [&] {
+            return getcoverage(gcnos, 0, header, tool);
+        });
+        check("gcov sweep for a header", seconds, files, header);
+        files = timed(seconds, [&] {
+            return getcoverage(gcnos, 0, source, tool);
+        });
+        check("gcov sweep for a source", seconds, files, source);
+
+        // vimgcovd keeps every source of the tree resident
+        coverage_index_t index{gcov_launcher(tool), 0};
+        auto lines = timed(seconds, [&] {
+            return index.lines(root.string(), header);
+        });
+        check("index sweep", seconds, lines ? files_t{{header, *lines}} :
+              files_t{}, header);
+        lines = timed(seconds, [&] {
+            return index.lines(root.string(), source);
+        });
+        check("index query", seconds, lines ? files_t{{source, *lines}} :
+              files_t{}, source);
+    }
+
+    const auto rss = max_rss_mib(RUSAGE_SELF);
+    std::cout << gcnos.size() << " TUs, peak RSS " << rss << " MiB" <<
+        std::endl;
+    ok &= rss <= max_rss;
+    if (!ok)
+        std::cerr << "exceeded " << max_seconds << " s or " << max_rss <<
+            " MiB" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#include "gcov_json_parser.hpp"
+#include "selectors.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+
+const std::string llvm_json = R"({
+    "data": [{
+        "files": [{
+            "filename": "/src/a.cpp",
+            "segments": [[1, 1, 2, true, true, false]],
+            "functions": [{
+                "filename": "/src/a.hpp",
+                "regions": [[3, 1, 4, 2, 5, 0, 0, 0]]
+            }, {
+                "filename": "/src/a.cpp",
+                "regions": [[2, 1, 2, 2, 0, 0, 0, 0]]
+            }]
+        }, {
+            "filename": "/src/b.cpp",
+            "segments": [[1, 1, 1, true, true, false]],
+            "functions": []
+        }, {
+            "filename": "/other/c.cpp",
+            "segments": [[1, 1, 7, true, true, false]],
+            "functions": []
+        }]
+    }]
+})";
+
+}
+
+TEST(SelectorsTest, Paths)
+{
+    EXPECT_TRUE(any_path_t{}(""));
+    const path_selector_t path{"/src/a.cpp"};
+    EXPECT_TRUE(path("/src/a.cpp"));
+    EXPECT_FALSE(path("/src/a.cp"));
+    EXPECT_FALSE(path("/src/a.cpp "));
+    const prefix_selector_t prefix{"/src/"};
+    EXPECT_TRUE(prefix("/src/a.cpp"));
+    EXPECT_FALSE(prefix("/src"));
+    EXPECT_TRUE(prefix_selector_t{""}("/other/c.cpp"));
+    const path_set_selector_t set{{"/src/b.cpp", "/src/a.cpp", "/src/a.cpp"}};
+    EXPECT_TRUE(set("/src/a.cpp"));
+    EXPECT_TRUE(set("/src/b.cpp"));
+    EXPECT_FALSE(set("/src/c.cpp"));
+    EXPECT_FALSE(path_set_selector_t{{}}("/src/a.cpp"));
+    const filename_selector_t empty;
+    EXPECT_TRUE(erased_selector_t{empty}("/src/a.cpp"));
+}
+
+// Test that the selector policies pick the same files as the type erased
+// overloads
+TEST(SelectorsTest, ParseLlvmJson)
+{
+    counted_files_t selected;
+    parse_llvm_json(selected, llvm_json,
+                    path_set_selector_t{{"/src/a.cpp", "/other/c.cpp"}});
+    const counted_files_t expected{
+        {"/src/a.cpp", {{1, 2}, {2, 0}}},
+        {"/other/c.cpp", {{1, 7}}},
+    };
+    EXPECT_EQ(selected, expected);
+
+    counted_files_t prefixed;
+    parse_llvm_json(prefixed, llvm_json, prefix_selector_t{"/src/"});
+    counted_files_t erased;
+    const filename_selector_t selector = [] (const std::string& x) {
+        return x.rfind("/src/", 0) == 0;
+    };
+    parse_llvm_json(erased, llvm_json, selector);
+    EXPECT_EQ(prefixed, erased);
+    EXPECT_EQ(prefixed.size(), 2u);
+
+    files_t single;
+    parse_llvm_json(single, llvm_json, path_selector_t{"/src/b.cpp"});
+    const files_t expected_single{{"/src/b.cpp", {{1, false}}}};
+    EXPECT_EQ(single, expected_single);
+}
+
+TEST(SelectorsTest, ParseGcovJson)
+{
+    const std::string json = R"({"files": [
+        {"file": "/src/a.cpp", "lines": [
+            {"line_number": 1, "count": 2, "unexecuted_block": false}]},
+        {"file": "/src/b.cpp", "lines": [
+            {"line_number": 1, "count": 0, "unexecuted_block": true}]}
+    ]})";
+    files_t files;
+    parse_gcov_json(files, json, path_selector_t{"/src/a.cpp"});
+    parse_gcov_json(files, json, path_selector_t{"/src/a.cpp"});
+    const files_t expected{{"/src/a.cpp", {{1, false}}}};
+    EXPECT_EQ(files, expected);
+}
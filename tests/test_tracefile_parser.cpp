@@ -0,0 +1,189 @@
+#include "tracefile_parser.hpp"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+#define EXPECT_THROW_WITH_MSG(x, msg) \
+    do \
+    { \
+        try \
+        { \
+            x; \
+            FAIL() << "expression didn't throw"; \
+        } \
+        catch (const std::exception& ex) { \
+            EXPECT_STREQ(ex.what(), msg); \
+        } \
+    } while(false);
+
+// Test that records of the same source from several tests are summed
+TEST(ParseLcovTest, Counts)
+{
+    std::istringstream in{
+        "TN:first\n"
+        "SF:/src/a.cpp\n"
+        "FN:1,main\n"
+        "DA:3,2\n"
+        "DA:1,1,checksum\n"
+        "LF:2\n"
+        "LH:2\n"
+        "end_of_record\n"
+        "SF:/src/b.cpp\n"
+        "DA:1,1\n"
+        "end_of_record\n"
+        "TN:second\r\n"
+        "SF:/src/a.cpp\r\n"
+        "DA:2,0\r\n"
+        "DA:3,5\r\n"
+        "end_of_record\r\n"
+    };
+    counted_files_t out;
+    parse_lcov(out, in, [] (const auto& x) { return x == "/src/a.cpp"; });
+    const counted_files_t expected{{"/src/a.cpp", {{1, 1}, {2, 0}, {3, 7}}}};
+    EXPECT_EQ(out, expected);
+}
+
+TEST(ParseLcovTest, Unexecuted)
+{
+    std::istringstream in{
+        "SF:/src/a.cpp\n"
+        "DA:1,0\n"
+        "DA:2,4\n"
+        "end_of_record\n"
+    };
+    files_t out;
+    parse_lcov(out, in, nullptr);
+    const files_t expected{{"/src/a.cpp", {{1, true}, {2, false}}}};
+    EXPECT_EQ(out, expected);
+}
+
+TEST(ParseLcovTest, InvalidRecords)
+{
+    files_t out;
+    std::istringstream outside{"DA:1,0\n"};
+    EXPECT_THROW_WITH_MSG(parse_lcov(out, outside, nullptr),
+                          "DA record outside of a SF record (line 1)");
+    std::istringstream invalid{"SF:/src/a.cpp\nDA:1\n"};
+    EXPECT_THROW_WITH_MSG(parse_lcov(out, invalid, nullptr),
+                          "Invalid DA record (line 2)");
+    std::istringstream negative{"SF:/src/a.cpp\nDA:1,-1\n"};
+    EXPECT_THROW_WITH_MSG(parse_lcov(out, negative, nullptr),
+                          "Invalid DA record (line 2)");
+}
+
+const char* const cobertura = R"xml(<?xml version="1.0" ?>
+<!DOCTYPE coverage SYSTEM 'http://cobertura.sourceforge.net/xml/coverage-04.dtd'>
+<coverage line-rate="0.5" version="gcovr 7.0">
+  <!-- a comment with <class filename="x"> inside -->
+  <sources>
+    <source>/src</source>
+  </sources>
+  <packages>
+    <package name="">
+      <classes>
+        <class name="a_cpp" filename="a.cpp" line-rate="0.5">
+          <methods>
+            <method name="main" signature="">
+              <lines>
+                <line number="1" hits="3"/>
+              </lines>
+            </method>
+          </methods>
+          <lines>
+            <line number="1" hits="3" branch="false"/>
+            <line number = '2' hits="0" branch="true" condition-coverage="50% (1/2)"/>
+          </lines>
+        </class>
+        <class name="b" filename="dir/b &amp; c.hpp" line-rate="1">
+          <lines>
+            <line number="4" hits="18446744073709551615"/>
+          </lines>
+        </class>
+        <class name="a_cpp_2" filename="/src/a.cpp">
+          <lines>
+            <line number="2" hits="1"/>
+          </lines>
+        </class>
+      </classes>
+    </package>
+  </packages>
+</coverage>
+)xml";
+
+TEST(ParseCoberturaTest, Counts)
+{
+    std::istringstream in{cobertura};
+    counted_files_t out;
+    parse_cobertura(out, in, nullptr);
+    const counted_files_t expected{
+        {"/src/a.cpp", {{1, 3}, {2, 1}}},
+        {"/src/dir/b & c.hpp", {{4, 18446744073709551615u}}},
+    };
+    EXPECT_EQ(out, expected);
+}
+
+TEST(ParseCoberturaTest, Selector)
+{
+    std::istringstream in{cobertura};
+    files_t out;
+    parse_cobertura(out, in, [] (const auto& x) { return x == "/src/a.cpp"; });
+    const files_t expected{{"/src/a.cpp", {{1, false}, {2, false}}}};
+    EXPECT_EQ(out, expected);
+}
+
+TEST(ParseCoberturaTest, InvalidLine)
+{
+    std::istringstream in{
+        R"(<coverage><class filename="a.cpp"><line hits="1"/></class>)"};
+    files_t out;
+    EXPECT_THROW_WITH_MSG(parse_cobertura(out, in, nullptr),
+                          "Line without 'number' attribute");
+}
+
+// Test that a class without lines doesn't collect the lines of the next,
+// skipped class and may be the last one
+TEST(ParseCoberturaTest, SelfClosingClass)
+{
+    std::istringstream skipped{
+        R"(<coverage><class filename="a.cpp"/>)"
+        R"(<class filename="b.cpp"><line number="1" hits="1"/></class>)"
+        R"(</coverage>)"};
+    files_t out;
+    parse_cobertura(out, skipped, [] (const auto& x) { return x == "a.cpp"; });
+    const files_t expected{{"a.cpp", {}}};
+    EXPECT_EQ(out, expected);
+
+    std::istringstream last{
+        R"(<coverage><class filename="b.cpp"><line number="1" hits="1"/>)"
+        R"(</class><class filename="a.cpp"/></coverage>)"};
+    files_t out_last;
+    parse_cobertura(out_last, last, nullptr);
+    const files_t expected_last{{"a.cpp", {}}, {"b.cpp", {{1, false}}}};
+    EXPECT_EQ(out_last, expected_last);
+}
+
+TEST(ParseTracefileTest, DetectsFormat)
+{
+    const auto dir = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path();
+    boost::filesystem::create_directories(dir);
+    const auto lcov = (dir / "coverage.info").string();
+    const auto xml = (dir / "coverage.xml").string();
+    std::ofstream{lcov} << "SF:/src/a.cpp\nDA:1,3\nDA:2,0\nend_of_record\n";
+    std::ofstream{xml} << "\n  " << cobertura;
+
+    counted_files_t from_lcov;
+    parse_tracefile(from_lcov, lcov, nullptr);
+    counted_files_t from_xml;
+    parse_tracefile(from_xml, xml, nullptr);
+    boost::filesystem::remove_all(dir);
+
+    const counted_lines_t expected_lcov{{1, 3}, {2, 0}};
+    EXPECT_EQ(from_lcov["/src/a.cpp"], expected_lcov);
+    const counted_lines_t expected_xml{{1, 3}, {2, 1}};
+    EXPECT_EQ(from_xml["/src/a.cpp"], expected_xml);
+
+    files_t out;
+    EXPECT_THROW(parse_tracefile(out, lcov, nullptr), parse_exception);
+}
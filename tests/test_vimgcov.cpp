@@ -1,6 +1,13 @@
 #include "vimgcov.hpp"
+#include "coverage_sweep.hpp"
+#include <boost/filesystem.hpp>
 #include <gtest/gtest.h>
 #include <fmt/core.h>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 
 TEST(test_vimcov, process_files)
 {
@@ -26,3 +33,263 @@ TEST(test_vimcov, process_files)
     };
     EXPECT_EQ(rv, expected);
 }
+
+TEST(test_vimcov, process_files_adaptive)
+{
+    std::deque<std::string> files;
+    files_t expected;
+    for (int i = 0; i < 20; ++i)
+    {
+        files.push_back(std::to_string(i));
+        expected[std::to_string(i)] = lines_t{};
+    }
+    const auto rv = process_files(
+        [] (const auto& file, auto& ap_err, auto& ap_out, auto& ctx) {
+            return std::make_unique<boost::process::child>(
+                PYTHON_EXECUTABLE, "-c", fmt::format("print({}, end='')", file),
+                boost::process::std_out > ap_out,
+                boost::process::std_err > ap_err,
+                ctx
+            );
+        },
+        [] (auto& files, const auto& buf) {
+            files[buf];
+        },
+        files,
+        0
+    );
+    EXPECT_EQ(rv, expected);
+}
+
+// Test that reports larger than the pipe buffer are read whole and that
+// failing children are skipped
+TEST(test_vimcov, spawn_launcher)
+{
+    const spawn_launcher_t launcher{PYTHON_EXECUTABLE, {
+        "-c", "import sys; n = int(sys.argv[1]); sys.stdout.write('x' * n); "
+              "sys.exit(n == 7)"}};
+    const auto rv = process_files(
+        launcher,
+        [] (auto& files, const auto& buf) {
+            files[std::to_string(buf.size())];
+        },
+        {"0", "7", "100", "5000000"},
+        2
+    );
+    const files_t expected{{"0", {}}, {"100", {}}, {"5000000", {}}};
+    EXPECT_EQ(rv, expected);
+
+    const spawn_launcher_t missing{"vimgcov-no-such-tool", {}};
+    EXPECT_TRUE(missing.path().empty());
+    EXPECT_THROW(process_files(missing, [] (auto&, const auto&) {}, {"a"}, 1),
+                 std::system_error);
+}
+
+// Test that the read ends left to the parent are close-on-exec, so a child
+// spawned by another thread can't hold back their EOF
+TEST(test_vimcov, spawn_launcher_cloexec)
+{
+    const spawn_launcher_t launcher{PYTHON_EXECUTABLE, {
+        "-c", "import sys; print(sys.argv[1], end='')"}};
+    boost::asio::io_context ctx;
+    boost::process::async_pipe ap_out{ctx};
+    boost::process::async_pipe ap_err{ctx};
+    auto child = launcher("x", ap_err, ap_out, ctx);
+    EXPECT_TRUE(::fcntl(ap_out.native_source(), F_GETFD) & FD_CLOEXEC);
+    EXPECT_TRUE(::fcntl(ap_err.native_source(), F_GETFD) & FD_CLOEXEC);
+    std::string out;
+    boost::system::error_code ec;
+    boost::asio::read(ap_out, boost::asio::dynamic_buffer(out), ec);
+    child->wait();
+    EXPECT_EQ(out, "x");
+}
+
+// Test that the job at the back runs alone and is answered before the
+// others are parsed
+TEST(test_vimcov, process_files_early_answer)
+{
+    std::vector<files_t> answers;
+    const auto rv = process_files(
+        spawn_launcher_t{PYTHON_EXECUTABLE, {
+            "-c", "import sys; print(sys.argv[1], end='')"}},
+        [] (auto& files, const auto& buf) {
+            files[buf];
+        },
+        {"other1", "other2", "matching"},
+        3,
+        [&answers] (const files_t& answer) {
+            answers.push_back(answer);
+        }
+    );
+    const std::vector<files_t> expected_answers{{{"matching", {}}}};
+    EXPECT_EQ(answers, expected_answers);
+    const files_t expected{{"matching", {}}, {"other1", {}}, {"other2", {}}};
+    EXPECT_EQ(rv, expected);
+}
+
+// Test that a launcher failing in a later batch while the first output is
+// still being parsed propagates its exception after the parsers finished
+TEST(test_vimcov, process_files_launcher_throws)
+{
+    const spawn_launcher_t launcher{PYTHON_EXECUTABLE, {
+        "-c", "import sys; print(sys.argv[1], end='')"}};
+    unsigned launched = 0;
+    EXPECT_THROW(process_files(
+        [&] (const auto& file, auto& ap_err, auto& ap_out, auto& ctx) {
+            if (launched++)
+                throw std::runtime_error{"out of processes"};
+            return launcher(file, ap_err, ap_out, ctx);
+        },
+        [] (auto& files, const auto& buf) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{200});
+            files[buf];
+        },
+        {"b", "a"},
+        1
+    ), std::runtime_error);
+    EXPECT_EQ(launched, 2u);
+}
+
+TEST(test_vimcov, coverage_sweep_empty)
+{
+    coverage_sweep_t<> sweep{{}, 0, "foo.cpp"};
+    EXPECT_EQ(sweep.first(), files_t{});
+    EXPECT_EQ(sweep.result(), files_t{});
+    EXPECT_TRUE(sweep.done());
+}
+
+// Test that a header no gcno is named after isn't answered early with the
+// view of the first TU, the lines only the other TU executed would show as
+// unexecuted
+TEST(test_vimcov, coverage_sweep_header)
+{
+    namespace fs = boost::filesystem;
+    const auto dir = fs::temp_directory_path() /
+        fs::unique_path("vimgcov-%%%%%%");
+    fs::create_directories(dir);
+    // gcov stand-in printing the gcno, which holds the json report
+    const auto gcov = (dir / "gcov").string();
+    std::ofstream{gcov} << "#!/bin/sh\nfor gcno; do :; done\n"
+                           "exec cat \"$gcno\"\n";
+    fs::permissions(gcov, fs::owner_all);
+    const auto report = [] (unsigned executed) {
+        return fmt::format(
+            R"({{"files": [{{"file": "/src/common.hpp", "lines": [)"
+            R"({{"line_number": 1, "count": {0}, "unexecuted_block": {1}}},)"
+            R"({{"line_number": 2, "count": {2}, "unexecuted_block": {3}}}]}}]}})",
+            executed == 1 ? 1 : 0, executed == 1 ? "false" : "true",
+            executed == 2 ? 3 : 0, executed == 2 ? "false" : "true");
+    };
+    std::ofstream{(dir / "a.cpp.gcno").string()} << report(1);
+    std::ofstream{(dir / "b.cpp.gcno").string()} << report(2);
+
+    coverage_sweep_t<> sweep{{(dir / "a.cpp.gcno").string(),
+                              (dir / "b.cpp.gcno").string()},
+                             1, "/src/common.hpp", gcov};
+    const files_t expected{{"/src/common.hpp", {{1, false}, {2, false}}}};
+    EXPECT_EQ(sweep.first(), expected);
+    EXPECT_TRUE(sweep.done());
+    EXPECT_EQ(sweep.result(), expected);
+    fs::remove_all(dir);
+}
+
+// Test that a cancelled sweep stops launching gcov and that only the answer
+// it already had is returned
+TEST(test_vimcov, coverage_sweep_cancel)
+{
+    namespace fs = boost::filesystem;
+    const auto dir = fs::temp_directory_path() /
+        fs::unique_path("vimgcov-%%%%%%");
+    fs::create_directories(dir);
+    // gcov stand-in logging its runs and printing the gcno
+    const auto gcov = (dir / "gcov").string();
+    const auto log = (dir / "log").string();
+    std::ofstream{gcov} << "#!/bin/sh\nfor gcno; do :; done\n"
+                           "echo \"$gcno\" >> " << log << "\n"
+                           "sleep 0.2\nexec cat \"$gcno\"\n";
+    fs::permissions(gcov, fs::owner_all);
+    std::deque<std::string> gcnos;
+    for (const auto name : {"a", "b", "c", "d"})
+    {
+        gcnos.push_back((dir / fmt::format("{}.cpp.gcno", name)).string());
+        std::ofstream{gcnos.back()} << fmt::format(
+            R"({{"files": [{{"file": "/src/{}.cpp", "lines": [)"
+            R"({{"line_number": 1, "count": 1, "unexecuted_block": false}}]}}]}})",
+            name);
+    }
+
+    coverage_sweep_t<> sweep{gcnos, 1, "/src/a.cpp", gcov};
+    const files_t expected{{"/src/a.cpp", {{1, false}}}};
+    EXPECT_EQ(sweep.first(), expected);
+    sweep.cancel();
+    EXPECT_TRUE(sweep.cancelled());
+    EXPECT_THROW(sweep.result(), std::runtime_error);
+    EXPECT_EQ(sweep.first(), expected);
+    std::ifstream in{log};
+    std::size_t runs = 0;
+    for (std::string line; std::getline(in, line);)
+        ++runs;
+    EXPECT_LT(runs, gcnos.size());
+    fs::remove_all(dir);
+}
+
+// Test that io_uring reads pipes to EOF and that process_files drains the
+// children through it when enabled
+TEST(test_vimcov, uring_reactor)
+{
+    std::optional<uring_reactor_t> uring;
+    try
+    {
+        uring.emplace(4);
+    }
+    catch (const std::system_error& ex)
+    {
+        GTEST_SKIP() << ex.what();
+    }
+
+    // more pipes than ring entries, so the ring grows, one of them empty
+    std::vector<int> write_ends;
+    std::vector<std::string> outs(6, "prefix");
+    std::vector<uring_reactor_t::pipe_t> pipes;
+    for (auto& out : outs)
+    {
+        int fds[2];
+        ASSERT_EQ(::pipe(fds), 0);
+        pipes.push_back({fds[0], &out});
+        write_ends.push_back(fds[1]);
+    }
+    std::thread writer{[&write_ends] {
+        const std::string chunk(100000, 'x');
+        for (std::size_t i = 0; i < write_ends.size(); ++i)
+        {
+            for (std::size_t n = 0; n < i * 10; ++n)
+                EXPECT_EQ(::write(write_ends[i], chunk.data(), chunk.size()),
+                          static_cast<ssize_t>(chunk.size()));
+            ::close(write_ends[i]);
+        }
+    }};
+    uring->read_all(pipes);
+    writer.join();
+    for (std::size_t i = 0; i < outs.size(); ++i)
+    {
+        EXPECT_EQ(outs[i].size(), 6 + i * 1000000);
+        EXPECT_EQ(outs[i].substr(0, 7), i ? "prefixx" : "prefix");
+        ::close(pipes[i].fd);
+    }
+    EXPECT_GT(uring->stats().reads, 0u);
+
+    ::setenv("VIMGCOV_IO_URING", "1", 1);
+    EXPECT_TRUE(uring_reactor_t::enabled());
+    const auto rv = process_files(
+        spawn_launcher_t{PYTHON_EXECUTABLE, {
+            "-c", "import sys; sys.stdout.write('x' * int(sys.argv[1]))"}},
+        [] (auto& files, const auto& buf) {
+            files[std::to_string(buf.size())];
+        },
+        {"0", "100", "5000000"},
+        2
+    );
+    ::unsetenv("VIMGCOV_IO_URING");
+    const files_t expected{{"0", {}}, {"100", {}}, {"5000000", {}}};
+    EXPECT_EQ(rv, expected);
+}
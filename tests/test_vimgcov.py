@@ -1,8 +1,17 @@
+import os
 import pytest
-from unittest.mock import patch
+from collections import OrderedDict
+from unittest.mock import MagicMock, patch
+import vimgcov
 from vimgcov import GetCoverageGcovLines
 
 
+@pytest.fixture(autouse=True)
+def no_daemon():
+    with patch("vimgcov.USE_DAEMON", False):
+        yield
+
+
 @pytest.fixture
 def mock_getcoverage():
     with patch("_vimgcov.getcoverage") as mock:
@@ -58,3 +67,145 @@ def test_get_coverage_gcov_lines_valid_file(temp_file, mock_getcoverage):
     covered, uncovered = GetCoverageGcovLines(temp_file)
     assert covered == [1, 3]
     assert uncovered == [2, 4]
+
+
+def test_get_coverage_gcov_lines_tracefile(temp_file, mock_getcoverage):
+    """
+    Test to verify that a configured tracefile is read instead of running
+    gcov.
+    """
+    temp_file = str(temp_file("testfile.c"))
+    with patch("vimgcov.TRACEFILE", "coverage.info"), \
+            patch("_vimgcov.gettracefilecoverage") as mock_tracefile:
+        mock_tracefile.return_value = {temp_file: [(1, True), (2, False)]}
+        covered, uncovered = GetCoverageGcovLines(temp_file)
+    mock_tracefile.assert_called_once_with("coverage.info", temp_file)
+    mock_getcoverage.assert_not_called()
+    assert covered == [2]
+    assert uncovered == [1]
+
+
+def test_get_coverage_rust_native(tmp_path, monkeypatch):
+    """
+    Test that rust coverage is read natively and llvm-cov is only run when
+    the native reader fails.
+    """
+    monkeypatch.chdir(tmp_path)
+    (tmp_path / "target/debug/deps").mkdir(parents=True)
+    (tmp_path / "default.profraw").touch()
+    source = tmp_path / "main.rs"
+    source.touch()
+    with patch("_vimgcov.getnativellvmcoverage") as mock_native, \
+            patch("vimgcov.get_llvm_cov_coverage") as mock_llvm_cov:
+        mock_native.return_value = {str(source): [(1, False), (2, True)]}
+        assert GetCoverageGcovLines(str(source)) == ([1], [2])
+        mock_native.assert_called_once_with([], ["default.profraw"],
+                                            str(source))
+        mock_llvm_cov.assert_not_called()
+
+        mock_native.side_effect = RuntimeError("Unsupported raw profile")
+        mock_llvm_cov.return_value = {str(source): [(3, True)]}
+        assert GetCoverageGcovLines(str(source)) == ([], [3])
+        mock_llvm_cov.assert_called_once_with([], ["default.profraw"],
+                                              str(source))
+
+
+def test_get_coverage_gcov_lines_early_answer(tmp_path, monkeypatch,
+                                              mock_getcoverage):
+    """
+    Test that the first answer of a sweep is returned while it runs, the
+    merged result once it finished and that a new sweep only starts after
+    the gcda files changed.
+    """
+    monkeypatch.chdir(tmp_path)
+    (tmp_path / "early.gcno").touch()
+    gcda = tmp_path / "early.gcda"
+    gcda.touch()
+    temp_file = str(tmp_path / "early.c")
+    (tmp_path / "early.c").touch()
+    with patch("vimgcov.EARLY_ANSWER", True), \
+            patch("vimgcov._sweeps", OrderedDict()), \
+            patch("vimgcov._cancelled", []), \
+            patch("_vimgcov.CoverageSweep") as mock_sweep:
+        sweep = mock_sweep.return_value
+        sweep.done.return_value = False
+        sweep.cancelled.return_value = False
+        sweep.first.return_value = {temp_file: [(1, False)]}
+        sweep.result.return_value = {temp_file: [(1, False), (2, True)]}
+        assert GetCoverageGcovLines(temp_file) == ([1], [])
+        assert GetCoverageGcovLines(temp_file) == ([1], [])
+        mock_sweep.assert_called_once()
+        sweep.done.return_value = True
+        assert GetCoverageGcovLines(temp_file) == ([1], [2])
+        assert GetCoverageGcovLines(temp_file) == ([1], [2])
+        mock_sweep.assert_called_once()
+        os.utime(gcda, ns=(0, gcda.stat().st_mtime_ns + 1))
+        assert GetCoverageGcovLines(temp_file) == ([1], [2])
+        assert mock_sweep.call_count == 2
+    mock_getcoverage.assert_not_called()
+
+
+def test_get_coverage_gcov_lines_early_answer_one_sweep(tmp_path, monkeypatch,
+                                                       mock_getcoverage):
+    """
+    Test that starting a sweep cancels the running one, which is kept until
+    it finished, and that at most MAX_SWEEPS finished sweeps are cached.
+    """
+    monkeypatch.chdir(tmp_path)
+    (tmp_path / "a.gcno").touch()
+    names = [str(tmp_path / f"{i}.c") for i in range(3)]
+    for name in names:
+        (tmp_path / name).touch()
+    sweeps = []
+
+    def new_sweep(gcnos, j, path):
+        sweep = MagicMock()
+        sweep.done.return_value = False
+        sweep.cancelled.return_value = False
+        sweep.first.return_value = {path: [(1, False)]}
+        sweeps.append(sweep)
+        return sweep
+
+    with patch("vimgcov.EARLY_ANSWER", True), \
+            patch("vimgcov.MAX_SWEEPS", 2), \
+            patch("vimgcov._sweeps", OrderedDict()) as cache, \
+            patch("vimgcov._cancelled", []), \
+            patch("_vimgcov.CoverageSweep", side_effect=new_sweep):
+        assert GetCoverageGcovLines(names[0]) == ([1], [])
+        assert GetCoverageGcovLines(names[1]) == ([1], [])
+        sweeps[0].cancel.assert_called_once()
+        assert vimgcov._cancelled == [sweeps[0]]
+        sweeps[0].done.return_value = True
+        sweeps[0].cancelled.return_value = True
+        sweeps[1].done.return_value = True
+        sweeps[1].result.return_value = {names[1]: [(1, False)]}
+        assert GetCoverageGcovLines(names[2]) == ([1], [])
+        sweeps[1].cancel.assert_not_called()
+        assert vimgcov._cancelled == []
+        assert list(cache) == names[1:]
+        # the first file was evicted and starts over
+        assert GetCoverageGcovLines(names[0]) == ([1], [])
+        assert len(sweeps) == 4
+        sweeps[2].cancel.assert_called_once()
+    mock_getcoverage.assert_not_called()
+
+
+def test_get_coverage_gcov_lines_daemon(temp_file, mock_getcoverage):
+    """
+    Test that a running daemon answers the query and that gcov runs in
+    process when none listens or the daemon fails.
+    """
+    temp_file = str(temp_file("daemon.c"))
+    mock_getcoverage.return_value = {temp_file: [(3, True)]}
+    with patch("vimgcov.USE_DAEMON", True), \
+            patch("_vimgcov.querydaemon") as mock_query:
+        mock_query.return_value = {temp_file: [(1, False), (2, True)]}
+        assert GetCoverageGcovLines(temp_file) == ([1], [2])
+        mock_query.assert_called_once_with("", os.getcwd(), temp_file)
+        mock_getcoverage.assert_not_called()
+
+        mock_query.return_value = None
+        assert GetCoverageGcovLines(temp_file) == ([], [3])
+        mock_query.side_effect = RuntimeError("vimgcovd: no such directory")
+        assert GetCoverageGcovLines(temp_file) == ([], [3])
+        assert mock_getcoverage.call_count == 2
@@ -23,7 +23,8 @@ def cpp_code():
     """
 
 
-def test_getcoverage(tmp_path, cpp_code):
+@pytest.fixture
+def compiled(tmp_path, cpp_code):
     test_cpp_file = tmp_path / "test.cpp"
     test_binary = tmp_path / "test_binary"
     gcno_file = tmp_path / "test_binary-test.gcno"
@@ -58,6 +59,11 @@ def test_getcoverage(tmp_path, cpp_code):
     print("GCDA file exists:", any(
         f.suffix == ".gcda" for f in tmp_path.iterdir()))
 
+    return test_cpp_file, gcno_file
+
+
+def test_getcoverage(compiled):
+    test_cpp_file, gcno_file = compiled
     print("[DEBUG] Running getcoverage...")
     try:
         coverage_data = _vimgcov.getcoverage(
@@ -78,3 +84,16 @@ def test_getcoverage(tmp_path, cpp_code):
     }
 
     assert coverage_data == expected_coverage
+
+
+def test_getcoveragecounts(compiled):
+    test_cpp_file, gcno_file = compiled
+    coverage_data = _vimgcov.getcoverage(
+        gcnos=[str(gcno_file)], j=1, path=str(test_cpp_file))
+    counts = _vimgcov.getcoveragecounts(
+        gcnos=[str(gcno_file)], j=1, path=str(test_cpp_file))
+
+    lines = memoryview(counts[str(test_cpp_file)]).tolist()
+    assert [(lineno, count == 0) for lineno, count in lines] == \
+        coverage_data[str(test_cpp_file)]
+    assert dict(lines)[13] == 1